@@ -17,15 +17,58 @@ CONFIG += dll
 DEFINES += NMMIMPORT_LIBRARY
 DEFINES += NOMINMAX
 
+# count the allocations of each phase in the memory profile: qmake CONFIG+=count_allocations
+count_allocations: DEFINES += NMMIMPORT_COUNT_ALLOCATIONS
+
 SOURCES += nmmimport.cpp \
     modselectiondialog.cpp \
     modedialog.cpp \
-    nmmpathsdialog.cpp
+    nmmpathsdialog.cpp \
+    normalizedpath.cpp \
+    installlogscanner.cpp \
+    virtualmodconfig.cpp \
+    directoryownership.cpp \
+    filetransaction.cpp \
+    batchdelete.cpp \
+    fileclone.cpp \
+    preflight.cpp \
+    importreport.cpp \
+    zipdirectory.cpp \
+    cacheindex.cpp \
+    inflate.cpp \
+    filesystem.cpp \
+    memoryfilesystem.cpp \
+    backgroundtask.cpp \
+    nameconflictdialog.cpp \
+    installlogsnapshot.cpp \
+    concurrencycontroller.cpp \
+    memoryprofile.cpp
 
 HEADERS += nmmimport.h \
     modselectiondialog.h \
     modedialog.h \
-    nmmpathsdialog.h
+    nmmpathsdialog.h \
+    normalizedpath.h \
+    installlogscanner.h \
+    parallel.h \
+    virtualmodconfig.h \
+    directoryownership.h \
+    filetransaction.h \
+    batchdelete.h \
+    fileclone.h \
+    preflight.h \
+    importreport.h \
+    zipdirectory.h \
+    cacheindex.h \
+    inflate.h \
+    filesystem.h \
+    memoryfilesystem.h \
+    cancellation.h \
+    backgroundtask.h \
+    nameconflictdialog.h \
+    installlogsnapshot.h \
+    concurrencycontroller.h \
+    memoryprofile.h
 
 RESOURCES += \
     nmmimport.qrc
@@ -33,11 +76,12 @@ RESOURCES += \
 FORMS += \
     modselectiondialog.ui \
     modedialog.ui \
-    nmmpathsdialog.ui
+    nmmpathsdialog.ui \
+    nameconflictdialog.ui
 
 INCLUDEPATH += ../../archive
 
-LIBS += -ladvapi32
+LIBS += -ladvapi32 -lpsapi
 
 include(../plugin_template.pri)
 
@@ -0,0 +1,118 @@
+/*
+Copyright (C) 2012 Sebastian Herbord. All rights reserved.
+
+This file is part of NMM Import plugin for MO
+
+NMM Import plugin is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+NMM Import plugin is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with NMM Import plugin.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "backgroundtask.h"
+
+#include <report.h>
+
+#include <QEventLoop>
+#include <exception>
+#include <thread>
+
+
+namespace {
+
+// the task whose worker is the current thread, if any
+thread_local BackgroundTask *currentTask = nullptr;
+
+}
+
+
+BackgroundTask::BackgroundTask(QProgressDialog *progress)
+{
+  // the receivers live on the ui thread, signals emitted by the worker are queued
+  if (progress != nullptr) {
+    connect(this, &BackgroundTask::labelTextChanged, progress, &QProgressDialog::setLabelText);
+    connect(this, &BackgroundTask::valueChanged, progress, &QProgressDialog::setValue);
+  }
+  connect(this, &BackgroundTask::errorReported, this, [] (const QString &message) {
+    MOBase::reportError(message);
+  });
+  qRegisterMetaType<std::function<void ()>>();
+  connect(this, &BackgroundTask::posted, this, [] (const std::function<void ()> &func) {
+    func();
+  });
+  // finished is only emitted on the ui thread, so checking isFinished and connecting to
+  // finished there can't miss the end of the work
+  connect(this, &BackgroundTask::workerFinished, this, [this] () {
+    m_Finished = true;
+    emit finished();
+  });
+}
+
+BackgroundTask::~BackgroundTask()
+{
+  if (m_Worker.joinable()) {
+    m_Worker.join();
+  }
+}
+
+void BackgroundTask::run(const std::function<void ()> &func)
+{
+  start(func);
+  wait();
+}
+
+void BackgroundTask::start(const std::function<void ()> &func)
+{
+  Q_ASSERT(!m_Worker.joinable());
+  m_Finished = false;
+  m_Worker = std::thread([this, func] () {
+    currentTask = this;
+    try {
+      func();
+    } catch (const std::exception &e) {
+      reportError(tr("unexpected error: %1").arg(e.what()));
+    }
+    currentTask = nullptr;
+    emit workerFinished();
+  });
+}
+
+void BackgroundTask::wait()
+{
+  if (!m_Worker.joinable()) {
+    return;
+  }
+  if (!m_Finished) {
+    QEventLoop loop;
+    connect(this, &BackgroundTask::finished, &loop, &QEventLoop::quit);
+    loop.exec();
+  }
+  m_Worker.join();
+}
+
+BackgroundTask *BackgroundTask::current()
+{
+  return currentTask;
+}
+
+void BackgroundTask::attachThread(BackgroundTask *task)
+{
+  currentTask = task;
+}
+
+void BackgroundTask::reportError(const QString &message)
+{
+  if (currentTask != nullptr) {
+    emit currentTask->errorReported(message);
+  } else {
+    MOBase::reportError(message);
+  }
+}
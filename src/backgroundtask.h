@@ -0,0 +1,127 @@
+/*
+Copyright (C) 2012 Sebastian Herbord. All rights reserved.
+
+This file is part of NMM Import plugin for MO
+
+NMM Import plugin is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+NMM Import plugin is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with NMM Import plugin.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef BACKGROUNDTASK_H
+#define BACKGROUNDTASK_H
+
+#include <QObject>
+#include <QProgressDialog>
+#include <QString>
+#include <functional>
+#include <thread>
+
+
+/**
+ * @brief runs work on a worker thread while the ui thread keeps handling events
+ *
+ * The ui thread waits in a local event loop until the work is done, so the work itself
+ * never has to process events. Progress and errors are passed to the ui thread through
+ * queued signals. Work can also be left running while the ui thread does something
+ * else, i.e. shows a dialog, and be waited for later.
+ */
+class BackgroundTask : public QObject
+{
+
+  Q_OBJECT
+
+public:
+
+  /**
+   * @param progress dialog to display progress in, may be null
+   */
+  explicit BackgroundTask(QProgressDialog *progress = nullptr);
+
+  /**
+   * @brief waits for a function still running, without processing events
+   */
+  ~BackgroundTask();
+
+  /**
+   * @brief run a function on a worker thread and wait for it to return
+   * @note only one function runs at a time, calls don't nest
+   */
+  void run(const std::function<void ()> &func);
+
+  /**
+   * @brief start a function on a worker thread and return right away
+   * @note finished is emitted on the ui thread once the function returned. It has to
+   *       be waited for before the next function is started
+   */
+  void start(const std::function<void ()> &func);
+
+  /**
+   * @brief wait for the function passed to start, processing events meanwhile
+   */
+  void wait();
+
+  /**
+   * @return true if the function passed to start has returned
+   */
+  bool isFinished() const { return m_Finished; }
+
+  /**
+   * @brief call a function on the ui thread, may be called from any thread
+   * @note calls still pending when the task is destroyed are dropped
+   */
+  void post(const std::function<void ()> &func) { emit posted(func); }
+
+  /**
+   * @brief update the progress dialog, may be called from the worker
+   */
+  void setLabelText(const QString &text) { emit labelTextChanged(text); }
+  void setValue(int value) { emit valueChanged(value); }
+
+  /**
+   * @brief report an error to the user
+   * @note may be called from any thread. On the worker of a task the message is handed
+   *       to the ui thread, otherwise it is displayed right away
+   */
+  static void reportError(const QString &message);
+
+  /**
+   * @return the task whose worker is the calling thread, nullptr if there is none
+   */
+  static BackgroundTask *current();
+
+  /**
+   * @brief let reportError on the calling thread report through a task
+   * @param task the task, nullptr to detach the thread again
+   * @note for helper threads the worker starts, so their errors reach the ui thread too
+   */
+  static void attachThread(BackgroundTask *task);
+
+signals:
+
+  void labelTextChanged(const QString &text);
+  void valueChanged(int value);
+  void errorReported(const QString &message);
+  void posted(const std::function<void ()> &func);
+  void workerFinished();
+  void finished();
+
+private:
+
+  std::thread m_Worker;
+  bool m_Finished { true };
+
+};
+
+Q_DECLARE_METATYPE(std::function<void ()>)
+
+#endif // BACKGROUNDTASK_H
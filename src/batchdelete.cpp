@@ -0,0 +1,137 @@
+/*
+Copyright (C) 2012 Sebastian Herbord. All rights reserved.
+
+This file is part of NMM Import plugin for MO
+
+NMM Import plugin is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+NMM Import plugin is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with NMM Import plugin.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "batchdelete.h"
+#include "filesystem.h"
+#include "parallel.h"
+
+#include <QDir>
+#include <QFile>
+#include <QHash>
+#include <QSet>
+#include <algorithm>
+
+#ifdef Q_OS_WIN
+#include <Windows.h>
+#include <utility.h>
+#else
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+
+namespace {
+
+// large directories are split up so they don't end up on a single thread
+const size_t BATCH_SIZE = 256;
+
+struct Batch {
+  QString directory;
+  std::vector<int> files;
+};
+
+void deleteBatch(const Batch &batch, const QStringList &files, std::vector<QString> &errors)
+{
+  int offset = batch.directory.size() + 1;
+#ifdef Q_OS_WIN
+  // windows has no directory handle based deletion, at least convert the directory once
+  std::wstring directory = QDir::toNativeSeparators(batch.directory).toStdWString() + L"\\";
+  for (auto iter = batch.files.begin(); iter != batch.files.end(); ++iter) {
+    std::wstring path = directory + files.at(*iter).mid(offset).toStdWString();
+    if (!::DeleteFileW(path.c_str())) {
+      errors[*iter] = MOBase::windowsErrorString(::GetLastError());
+    }
+  }
+#else
+  int directoryFD = ::open(QFile::encodeName(batch.directory).constData(), O_RDONLY | O_DIRECTORY);
+  if (directoryFD == -1) {
+    QString error = QString::fromLocal8Bit(strerror(errno));
+    for (auto iter = batch.files.begin(); iter != batch.files.end(); ++iter) {
+      errors[*iter] = error;
+    }
+    return;
+  }
+  for (auto iter = batch.files.begin(); iter != batch.files.end(); ++iter) {
+    if (::unlinkat(directoryFD, QFile::encodeName(files.at(*iter).mid(offset)).constData(), 0) != 0) {
+      errors[*iter] = QString::fromLocal8Bit(strerror(errno));
+    }
+  }
+  ::close(directoryFD);
+#endif
+}
+
+} // namespace
+
+
+std::vector<QString> deleteFiles(const QStringList &files, unsigned int concurrency)
+{
+  std::vector<Batch> batches;
+  QHash<QString, size_t> openBatches;
+  for (int i = 0; i < files.size(); ++i) {
+    QString directory = files.at(i).left(files.at(i).lastIndexOf('/'));
+    auto iter = openBatches.find(directory);
+    if ((iter == openBatches.end()) || (batches[*iter].files.size() >= BATCH_SIZE)) {
+      Batch batch;
+      batch.directory = directory;
+      openBatches[directory] = batches.size();
+      batches.push_back(batch);
+      iter = openBatches.find(directory);
+    }
+    batches[*iter].files.push_back(i);
+  }
+
+  std::vector<QString> errors(files.size());
+  parallelFor(batches.size(), concurrency, [&] (size_t index) {
+    deleteBatch(batches[index], files, errors);
+  });
+  return errors;
+}
+
+
+QStringList pruneEmptyDirectories(FileSystem &fileSystem, const QStringList &directories, const QString &root)
+{
+  QString prefix = root.endsWith('/') ? root : root + "/";
+
+  // collect the directories with all their parents up to the root
+  QSet<QString> candidates;
+  foreach (const QString &directory, directories) {
+    for (QString current = directory;
+         current.startsWith(prefix, Qt::CaseInsensitive) && !candidates.contains(current);
+         current = current.left(current.lastIndexOf('/'))) {
+      candidates.insert(current);
+    }
+  }
+
+  // children have to go before their parents
+  QStringList sorted = candidates.toList();
+  std::sort(sorted.begin(), sorted.end(), [] (const QString &lhs, const QString &rhs) {
+    return lhs.count('/') > rhs.count('/');
+  });
+
+  QStringList result;
+  foreach (const QString &directory, sorted) {
+    // removal fails on directories that aren't empty which is exactly what we want
+    if (fileSystem.removeDirectory(directory)) {
+      result.append(directory);
+    }
+  }
+  return result;
+}
@@ -0,0 +1,50 @@
+/*
+Copyright (C) 2012 Sebastian Herbord. All rights reserved.
+
+This file is part of NMM Import plugin for MO
+
+NMM Import plugin is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+NMM Import plugin is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with NMM Import plugin.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef BATCHDELETE_H
+#define BATCHDELETE_H
+
+#include <QString>
+#include <QStringList>
+#include <vector>
+
+class FileSystem;
+
+
+/**
+ * @brief delete files in parallel batches
+ *
+ * Files are grouped by directory, each directory is resolved once per batch and the
+ * batches are processed on worker threads.
+ * @param files absolute paths of the files, using '/' as separator
+ * @param concurrency maximum number of batches processed at the same time
+ * @return one entry per file, empty if the file was deleted, the reason otherwise
+ */
+std::vector<QString> deleteFiles(const QStringList &files, unsigned int concurrency);
+
+/**
+ * @brief remove directories that are empty, deepest first, parents included
+ * @param fileSystem the file system the directories are on
+ * @param directories absolute paths of the directories to check, using '/' as separator
+ * @param root only directories strictly below this one are touched
+ * @return the directories that were removed, in the order they were removed
+ */
+QStringList pruneEmptyDirectories(FileSystem &fileSystem, const QStringList &directories, const QString &root);
+
+#endif // BATCHDELETE_H
@@ -0,0 +1,217 @@
+/*
+Copyright (C) 2012 Sebastian Herbord. All rights reserved.
+
+This file is part of NMM Import plugin for MO
+
+NMM Import plugin is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+NMM Import plugin is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with NMM Import plugin.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/**
+ * Runs the file transfer part of an import against a MemoryFileSystem: the mod files are
+ * copied to the mod directories through FileTransaction::copyFiles, the sources removed
+ * and the whole transaction rolled back, like an import that is undone. The storage
+ * latency is simulated so the effect of the concurrency control can be measured without
+ * a disk. Timings, and the memory profile if requested, are written to stdout as json.
+ */
+
+#include "concurrencycontroller.h"
+#include "filetransaction.h"
+#include "memoryfilesystem.h"
+#include "memoryprofile.h"
+#include "parallel.h"
+
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QTextStream>
+#include <algorithm>
+#include <memory>
+#include <vector>
+
+
+namespace {
+
+struct Options {
+  int mods;
+  int filesPerMod;
+  int fileSize;
+  qint64 latency;
+  qint64 bytesPerSecond;
+  bool adaptive;
+  bool profile;
+  QString trace;
+};
+
+int intValue(const QCommandLineParser &parser, const QString &name, int minimum)
+{
+  bool ok = false;
+  int result = parser.value(name).toInt(&ok);
+  return ok ? std::max(result, minimum) : minimum;
+}
+
+QString modDirectory(const QString &base, int mod)
+{
+  return QString("%1/mod%2/").arg(base).arg(mod);
+}
+
+QString filePath(int file)
+{
+  // spread the files over a few directories like a typical mod
+  return QString("textures/set%1/file%2.dds").arg(file % 8).arg(file);
+}
+
+} // namespace
+
+
+int main(int argc, char *argv[])
+{
+  QCoreApplication application(argc, argv);
+  QCoreApplication::setApplicationName("nmmimport_benchmark");
+
+  QCommandLineParser parser;
+  parser.setApplicationDescription("measures the transfer of mod files against an in-memory file system");
+  parser.addHelpOption();
+  parser.addOption({ "mods", "number of mods", "count", "20" });
+  parser.addOption({ "files", "files per mod", "count", "500" });
+  parser.addOption({ "size", "size of each file in bytes", "bytes", "16384" });
+  parser.addOption({ "latency", "simulated latency of each operation", "microseconds", "200" });
+  parser.addOption({ "throughput", "simulated throughput, 0 for unlimited", "bytes per second", "0" });
+  parser.addOption({ "fixed", "always use the maximum concurrency" });
+  parser.addOption({ "profile", "record the memory use of each phase" });
+  parser.addOption({ "trace", "write the concurrency measurements to a file", "file" });
+  parser.process(application);
+
+  Options options;
+  options.mods = intValue(parser, "mods", 1);
+  options.filesPerMod = intValue(parser, "files", 1);
+  options.fileSize = intValue(parser, "size", 0);
+  options.latency = intValue(parser, "latency", 0);
+  options.bytesPerSecond = intValue(parser, "throughput", 0);
+  options.adaptive = !parser.isSet("fixed");
+  options.profile = parser.isSet("profile");
+  options.trace = parser.value("trace");
+
+  std::unique_ptr<MemoryProfile> profile;
+  if (options.profile) {
+    profile.reset(new MemoryProfile);
+  }
+
+  QString root = QDir::rootPath() + "nmmimport_benchmark";
+  QString sourceRoot = root + "/install";
+  QString modsRoot = root + "/mods";
+
+  MemoryFileSystem fileSystem;
+  QJsonObject phases;
+  QElapsedTimer timer;
+
+  MemoryProfile::beginPhase("populate");
+  timer.start();
+  QByteArray content(options.fileSize, 'x');
+  for (int mod = 0; mod < options.mods; ++mod) {
+    QString directory = modDirectory(sourceRoot, mod);
+    for (int file = 0; file < options.filesPerMod; ++file) {
+      fileSystem.addFile(directory + filePath(file), content);
+    }
+  }
+  phases["populate"] = timer.elapsed();
+
+  // latency only applies to the operations measured
+  fileSystem.setLatency(options.latency, options.bytesPerSecond);
+
+  ConcurrencyController controller(workerCount(), options.adaptive);
+  if (!options.trace.isEmpty() && !controller.setTraceFile(options.trace)) {
+    qWarning("failed to open trace file \"%s\"", qPrintable(options.trace));
+  }
+
+  FileTransaction transaction(fileSystem);
+  transaction.setConcurrencyController(&controller);
+
+  bool success = true;
+
+  MemoryProfile::beginPhase("copy");
+  timer.restart();
+  // hand the copies over slice by slice the way installMod does
+  std::vector<FileTransaction::Transfer> copies;
+  copies.reserve(FileTransaction::COPY_SLICE_SIZE);
+  for (int mod = 0; (mod < options.mods) && success; ++mod) {
+    QString source = modDirectory(sourceRoot, mod);
+    QString destination = modDirectory(modsRoot, mod);
+    for (int file = 0; (file < options.filesPerMod) && success; ++file) {
+      copies.push_back({ source, destination, NormalizedPath(filePath(file)) });
+      if (copies.size() == static_cast<size_t>(FileTransaction::COPY_SLICE_SIZE)) {
+        success = transaction.copyFiles(copies);
+        copies.clear();
+      }
+    }
+  }
+  if (success && !copies.empty()) {
+    success = transaction.copyFiles(copies);
+  }
+  phases["copy"] = timer.elapsed();
+
+  QStringList failures;
+  if (success) {
+    MemoryProfile::beginPhase("remove sources");
+    timer.restart();
+    success = transaction.removeCopySources(0, sourceRoot, failures);
+    phases["removeSources"] = timer.elapsed();
+  }
+
+  MemoryProfile::beginPhase("rollback");
+  timer.restart();
+  bool rolledBack = transaction.rollback();
+  phases["rollback"] = timer.elapsed();
+  MemoryProfile::endPhase();
+
+  // after the rollback every source has to be back in place
+  fileSystem.setLatency(0);
+  int missing = 0;
+  for (int mod = 0; mod < options.mods; ++mod) {
+    QString directory = modDirectory(sourceRoot, mod);
+    for (int file = 0; file < options.filesPerMod; ++file) {
+      if (fileSystem.fileSize(directory + filePath(file)) != options.fileSize) {
+        ++missing;
+      }
+    }
+  }
+
+  QJsonObject settings;
+  settings["mods"] = options.mods;
+  settings["filesPerMod"] = options.filesPerMod;
+  settings["fileSize"] = options.fileSize;
+  settings["latencyUs"] = options.latency;
+  settings["bytesPerSecond"] = options.bytesPerSecond;
+  settings["adaptive"] = options.adaptive;
+  settings["maxConcurrency"] = static_cast<int>(workerCount());
+
+  QJsonObject result;
+  result["settings"] = settings;
+  result["milliseconds"] = phases;
+  result["success"] = success;
+  result["error"] = success ? QString() : transaction.errorString();
+  result["failures"] = failures.size();
+  result["rolledBack"] = rolledBack;
+  result["missingAfterRollback"] = missing;
+  result["finalConcurrency"] = static_cast<int>(controller.concurrency());
+  if (profile) {
+    result["memory"] = profile->toJson();
+  }
+
+  QTextStream(stdout) << QJsonDocument(result).toJson();
+
+  return (success && rolledBack && (missing == 0)) ? 0 : 1;
+}
@@ -0,0 +1,50 @@
+/*
+Copyright (C) 2012 Sebastian Herbord. All rights reserved.
+
+This file is part of NMM Import plugin for MO
+
+NMM Import plugin is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+NMM Import plugin is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with NMM Import plugin.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "cacheindex.h"
+#include "parallel.h"
+
+#include <QDir>
+
+
+void CacheIndex::build(const QStringList &archives)
+{
+  std::vector<ZipDirectory> directories(archives.size());
+  std::vector<char> valid(archives.size(), 0);
+  parallelFor(archives.size(), [&] (size_t index) {
+    valid[index] = directories[index].read(archives.at(static_cast<int>(index)));
+  });
+
+  m_Archives.clear();
+  m_ArchivesByPath.clear();
+  for (size_t i = 0; i < directories.size(); ++i) {
+    if (valid[i]) {
+      m_ArchivesByPath.insert(QDir::cleanPath(archives.at(static_cast<int>(i))).toLower(), m_Archives.size());
+      m_Archives.push_back(std::move(directories[i]));
+    } else {
+      qDebug("%s not indexed", qPrintable(archives.at(static_cast<int>(i))));
+    }
+  }
+}
+
+const ZipDirectory *CacheIndex::find(const QString &archive) const
+{
+  auto iter = m_ArchivesByPath.find(QDir::cleanPath(archive).toLower());
+  return iter != m_ArchivesByPath.end() ? &m_Archives[*iter] : nullptr;
+}
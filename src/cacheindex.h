@@ -0,0 +1,61 @@
+/*
+Copyright (C) 2012 Sebastian Herbord. All rights reserved.
+
+This file is part of NMM Import plugin for MO
+
+NMM Import plugin is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+NMM Import plugin is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with NMM Import plugin.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef CACHEINDEX_H
+#define CACHEINDEX_H
+
+#include "zipdirectory.h"
+
+#include <QHash>
+#include <QString>
+#include <QStringList>
+#include <vector>
+
+
+/**
+ * @brief index of the archives in NMMs cache folder
+ *
+ * NMM keeps a zip of the files it installed for each mod in "cache". The central
+ * directories of these are read once, in parallel, so later stages can decide what to
+ * extract without opening the archives again.
+ */
+class CacheIndex
+{
+public:
+
+  /**
+   * @brief read the directories of the specified archives
+   * @param archives absolute paths of the archives. Those that don't exist or aren't zip
+   *                 files are left out of the index
+   */
+  void build(const QStringList &archives);
+
+  /**
+   * @return the directory of the archive or nullptr if it isn't indexed
+   */
+  const ZipDirectory *find(const QString &archive) const;
+
+private:
+
+  std::vector<ZipDirectory> m_Archives;
+  QHash<QString, size_t> m_ArchivesByPath;
+
+};
+
+#endif // CACHEINDEX_H
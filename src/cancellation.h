@@ -0,0 +1,47 @@
+/*
+Copyright (C) 2012 Sebastian Herbord. All rights reserved.
+
+This file is part of NMM Import plugin for MO
+
+NMM Import plugin is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+NMM Import plugin is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with NMM Import plugin.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef CANCELLATION_H
+#define CANCELLATION_H
+
+#include <atomic>
+
+
+/**
+ * @brief shared flag to stop a long running operation early
+ *
+ * Long loops check the token at regular intervals and wind down in a consistent state
+ * once it's set. Checking is a single atomic load, the token may be set and checked
+ * from any thread.
+ */
+class CancellationToken
+{
+public:
+
+  void cancel() { m_Cancelled = true; }
+
+  bool isCancelled() const { return m_Cancelled.load(std::memory_order_relaxed); }
+
+private:
+
+  std::atomic<bool> m_Cancelled { false };
+
+};
+
+#endif // CANCELLATION_H
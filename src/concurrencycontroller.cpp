@@ -0,0 +1,138 @@
+/*
+Copyright (C) 2012 Sebastian Herbord. All rights reserved.
+
+This file is part of NMM Import plugin for MO
+
+NMM Import plugin is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+NMM Import plugin is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with NMM Import plugin.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "concurrencycontroller.h"
+
+#include <algorithm>
+
+
+namespace {
+
+// shorter samples are dominated by noise and caching effects (microseconds)
+const qint64 SAMPLE_TIME = 200000;
+
+// changes in throughput smaller than this fraction are considered noise
+const double TOLERANCE = 0.05;
+
+// once an operation takes this many times as long as the fastest seen, requests
+// are queueing up instead of being served in parallel
+const double LATENCY_LIMIT = 4.0;
+
+const unsigned int INITIAL_CONCURRENCY = 4;
+
+}
+
+
+ConcurrencyController::ConcurrencyController(unsigned int maximum, bool adaptive)
+  : m_Maximum(std::max(1u, maximum)), m_Adaptive(adaptive)
+  , m_Concurrency(adaptive ? std::min(INITIAL_CONCURRENCY, m_Maximum) : m_Maximum)
+{
+  m_Clock.start();
+}
+
+void ConcurrencyController::record(int operations, qint64 bytes, qint64 elapsed, unsigned int concurrency)
+{
+  if (operations <= 0) {
+    return;
+  }
+
+  if ((m_Operations > 0)
+      && (((bytes > 0) != (m_Bytes > 0)) || (concurrency != m_SampleConcurrency))) {
+    // a different kind of operation or concurrency, the sample so far can't be combined
+    m_Operations = 0;
+    m_Bytes = 0;
+    m_Elapsed = 0;
+  }
+  m_Operations += operations;
+  m_Bytes += bytes;
+  m_Elapsed += elapsed;
+  m_SampleConcurrency = concurrency;
+  if (m_Elapsed < SAMPLE_TIME) {
+    return;
+  }
+
+  bool inBytes = m_Bytes > 0;
+  double throughput = (inBytes ? m_Bytes : m_Operations) * 1000000.0 / m_Elapsed;
+  // time each operation occupied one of the concurrent slots
+  double latency = static_cast<double>(m_Elapsed) * concurrency / m_Operations;
+
+  unsigned int previous = m_Concurrency;
+  if (m_Adaptive) {
+    if ((inBytes != m_LastInBytes) || (m_LastThroughput <= 0.0)) {
+      // nothing to compare with, keep probing in the current direction
+      m_MinLatency = latency;
+    } else if (throughput < m_LastThroughput * (1.0 - TOLERANCE)) {
+      // the last step made things worse
+      m_Direction = -m_Direction;
+    } else if (throughput <= m_LastThroughput * (1.0 + TOLERANCE)) {
+      // no gain, the same throughput with fewer requests in flight is preferable
+      m_Direction = -1;
+    }
+    m_MinLatency = std::min(m_MinLatency, latency);
+    if (latency > m_MinLatency * LATENCY_LIMIT) {
+      m_Direction = -1;
+    }
+    m_LastThroughput = throughput;
+    m_LastInBytes = inBytes;
+    adjust();
+  }
+  trace(throughput, latency, previous);
+
+  m_Operations = 0;
+  m_Bytes = 0;
+  m_Elapsed = 0;
+}
+
+void ConcurrencyController::adjust()
+{
+  long next = static_cast<long>(m_Concurrency) + m_Direction;
+  if ((next < 1) || (next > static_cast<long>(m_Maximum))) {
+    // at the limit, the next step probes the other way
+    m_Direction = -m_Direction;
+  } else {
+    m_Concurrency = static_cast<unsigned int>(next);
+  }
+}
+
+bool ConcurrencyController::setTraceFile(const QString &fileName)
+{
+  m_Trace.close();
+  m_Trace.setFileName(fileName);
+  if (!m_Trace.open(QIODevice::WriteOnly | QIODevice::Append | QIODevice::Text)) {
+    qWarning("failed to open trace file %s: %s", qPrintable(fileName), qPrintable(m_Trace.errorString()));
+    return false;
+  }
+  if (m_Trace.size() == 0) {
+    m_Trace.write("time_ms\toperations\tbytes\telapsed_us\tconcurrency\tthroughput\tlatency_us\tnext_concurrency\n");
+  }
+  return true;
+}
+
+void ConcurrencyController::trace(double throughput, double latency, unsigned int previous)
+{
+  if (!m_Trace.isOpen()) {
+    return;
+  }
+  m_Trace.write(QString("%1\t%2\t%3\t%4\t%5\t%6\t%7\t%8\n")
+                .arg(m_Clock.elapsed()).arg(m_Operations).arg(m_Bytes).arg(m_Elapsed)
+                .arg(previous).arg(throughput, 0, 'f', 1).arg(latency, 0, 'f', 1)
+                .arg(m_Concurrency).toUtf8());
+  m_Trace.flush();
+}
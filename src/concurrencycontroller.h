@@ -0,0 +1,99 @@
+/*
+Copyright (C) 2012 Sebastian Herbord. All rights reserved.
+
+This file is part of NMM Import plugin for MO
+
+NMM Import plugin is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+NMM Import plugin is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with NMM Import plugin.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef CONCURRENCYCONTROLLER_H
+#define CONCURRENCYCONTROLLER_H
+
+#include <QElapsedTimer>
+#include <QFile>
+#include <QString>
+
+
+/**
+ * @brief decides how many file operations run at the same time
+ *
+ * Spinning disks get slower with every request competing for the head while ssds only
+ * reach their full speed with many requests in flight. In adaptive mode the throughput
+ * of the batches reported is measured and the concurrency moved one step at a time in
+ * whichever direction improved it. When the time per operation grows without a gain in
+ * throughput the requests are only queueing up and the concurrency is reduced. Otherwise
+ * the maximum is used throughout.
+ * @note not thread safe, batches are expected to be run and reported by one thread
+ */
+class ConcurrencyController
+{
+public:
+
+  /**
+   * @param maximum upper limit for the number of concurrent operations
+   * @param adaptive adjust the concurrency to the measured throughput. If false the
+   *                 maximum is always used
+   */
+  ConcurrencyController(unsigned int maximum, bool adaptive);
+
+  /**
+   * @return the number of operations to run concurrently for the next batch
+   */
+  unsigned int concurrency() const { return m_Concurrency; }
+
+  /**
+   * @brief report a finished batch
+   * @param operations number of operations in the batch
+   * @param bytes data transfered by the batch, 0 for operations that don't move data
+   * @param elapsed wall clock time the batch took, in microseconds
+   * @param concurrency number of operations that ran at the same time
+   */
+  void record(int operations, qint64 bytes, qint64 elapsed, unsigned int concurrency);
+
+  /**
+   * @brief write a line for each measurement to the specified file
+   * @return false if the file can't be opened
+   */
+  bool setTraceFile(const QString &fileName);
+
+private:
+
+  void adjust();
+  void trace(double throughput, double latency, unsigned int previous);
+
+private:
+
+  unsigned int m_Maximum;
+  bool m_Adaptive;
+  unsigned int m_Concurrency;
+  int m_Direction { 1 };
+
+  // measurements are accumulated until they cover enough time to be meaningful
+  int m_Operations { 0 };
+  qint64 m_Bytes { 0 };
+  qint64 m_Elapsed { 0 };
+  unsigned int m_SampleConcurrency { 0 };
+
+  // throughput of the previous sample and whether it was in bytes or operations
+  double m_LastThroughput { 0.0 };
+  bool m_LastInBytes { false };
+  double m_MinLatency { 0.0 };
+
+  QFile m_Trace;
+  QElapsedTimer m_Clock;
+
+};
+
+#endif // CONCURRENCYCONTROLLER_H
@@ -0,0 +1,71 @@
+/*
+Copyright (C) 2012 Sebastian Herbord. All rights reserved.
+
+This file is part of NMM Import plugin for MO
+
+NMM Import plugin is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+NMM Import plugin is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with NMM Import plugin.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "directoryownership.h"
+
+
+void DirectoryOwnership::addFile(const NormalizedPath &path, const QString &mod)
+{
+  QString fullPath = path.relative().toString();
+  for (int separator = fullPath.lastIndexOf('/'); separator > 0;
+       separator = fullPath.lastIndexOf('/', separator - 1)) {
+    QString directoryPath = fullPath.left(separator);
+    NormalizedPath key(directoryPath);
+    auto iter = m_Directories.find(key);
+    if (iter == m_Directories.end()) {
+      Directory directory = { directoryPath, mod, 1, false };
+      m_Directories.insert(key, directory);
+    } else {
+      ++iter->fileCount;
+      if (iter->owner != mod) {
+        iter->shared = true;
+      }
+    }
+  }
+}
+
+void DirectoryOwnership::groupSubtrees()
+{
+  m_Subtrees.clear();
+  for (auto iter = m_Directories.begin(); iter != m_Directories.end(); ++iter) {
+    if (iter->shared) {
+      continue;
+    }
+    // only report the topmost directory of each subtree
+    int separator = iter->path.lastIndexOf('/');
+    if (separator != -1) {
+      auto parent = m_Directories.find(NormalizedPath(iter->path.left(separator)));
+      if ((parent != m_Directories.end()) && !parent->shared && (parent->owner == iter->owner)) {
+        continue;
+      }
+    }
+    m_Subtrees[iter->owner].append(iter->path);
+  }
+}
+
+QStringList DirectoryOwnership::ownedSubtrees(const QString &mod) const
+{
+  return m_Subtrees.value(mod);
+}
+
+int DirectoryOwnership::fileCount(const QString &directory) const
+{
+  auto iter = m_Directories.find(NormalizedPath(directory));
+  return iter != m_Directories.end() ? iter->fileCount : 0;
+}
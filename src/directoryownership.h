@@ -0,0 +1,82 @@
+/*
+Copyright (C) 2012 Sebastian Herbord. All rights reserved.
+
+This file is part of NMM Import plugin for MO
+
+NMM Import plugin is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+NMM Import plugin is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with NMM Import plugin.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef DIRECTORYOWNERSHIP_H
+#define DIRECTORYOWNERSHIP_H
+
+#include "normalizedpath.h"
+
+#include <QHash>
+#include <QString>
+#include <QStringList>
+
+
+/**
+ * @brief determines which directories below the data directory hold files of only one mod
+ *
+ * Built from the file lists in the InstallLog. A directory is owned by a mod if every
+ * file below it, at any depth, was installed by that mod and no other.
+ */
+class DirectoryOwnership
+{
+public:
+
+  /**
+   * @brief register a file installed by a mod
+   * @param path the file. Its relative part has to be relative to the data directory
+   * @param mod key of the mod that installed it. A file installed by several mods has
+   *            to be registered once for each
+   */
+  void addFile(const NormalizedPath &path, const QString &mod);
+
+  /**
+   * @brief determine the subtrees owned by each mod
+   * @note has to be called after the last file was added and before ownedSubtrees
+   */
+  void groupSubtrees();
+
+  /**
+   * @brief the topmost directories owned by a mod
+   * @param mod key of the mod
+   * @return directories relative to the data directory, none of them inside another
+   */
+  QStringList ownedSubtrees(const QString &mod) const;
+
+  /**
+   * @return number of files the log lists below the directory
+   */
+  int fileCount(const QString &directory) const;
+
+private:
+
+  struct Directory {
+    QString path;
+    QString owner;
+    int fileCount;
+    bool shared;
+  };
+
+private:
+
+  QHash<NormalizedPath, Directory> m_Directories;
+  QHash<QString, QStringList> m_Subtrees;
+
+};
+
+#endif // DIRECTORYOWNERSHIP_H
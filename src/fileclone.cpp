@@ -0,0 +1,200 @@
+/*
+Copyright (C) 2012 Sebastian Herbord. All rights reserved.
+
+This file is part of NMM Import plugin for MO
+
+NMM Import plugin is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+NMM Import plugin is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with NMM Import plugin.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "fileclone.h"
+
+#include <QDir>
+#include <QFile>
+#include <QStorageInfo>
+#include <QTemporaryFile>
+#include <algorithm>
+
+#ifdef Q_OS_WIN
+#include <Windows.h>
+#include <winioctl.h>
+#else
+#include <unistd.h>
+#ifdef Q_OS_LINUX
+#include <fcntl.h>
+#include <linux/fs.h>
+#include <sys/ioctl.h>
+#endif
+#endif
+
+
+#if defined(Q_OS_WIN) && defined(FSCTL_DUPLICATE_EXTENTS_TO_FILE)
+
+namespace {
+
+class HandleGuard {
+public:
+  explicit HandleGuard(HANDLE handle) : m_Handle(handle) {}
+  ~HandleGuard() { if (m_Handle != INVALID_HANDLE_VALUE) ::CloseHandle(m_Handle); }
+  HANDLE get() const { return m_Handle; }
+  bool isValid() const { return m_Handle != INVALID_HANDLE_VALUE; }
+private:
+  HandleGuard(const HandleGuard&);
+  HandleGuard &operator=(const HandleGuard&);
+  HANDLE m_Handle;
+};
+
+bool duplicateExtents(HANDLE source, HANDLE destination)
+{
+  // the clone has to match the source in integrity stream setting, sparseness and size
+  // before extents can be duplicated into it
+  FSCTL_GET_INTEGRITY_INFORMATION_BUFFER integrity;
+  DWORD bytesReturned = 0;
+  if (!::DeviceIoControl(source, FSCTL_GET_INTEGRITY_INFORMATION, nullptr, 0,
+                         &integrity, sizeof(integrity), &bytesReturned, nullptr)) {
+    return false;
+  }
+  FSCTL_SET_INTEGRITY_INFORMATION_BUFFER setIntegrity = { integrity.ChecksumAlgorithm, 0, integrity.Flags };
+  if (!::DeviceIoControl(destination, FSCTL_SET_INTEGRITY_INFORMATION, &setIntegrity, sizeof(setIntegrity),
+                         nullptr, 0, &bytesReturned, nullptr)) {
+    return false;
+  }
+
+  BY_HANDLE_FILE_INFORMATION info;
+  if (!::GetFileInformationByHandle(source, &info)) {
+    return false;
+  }
+  if (((info.dwFileAttributes & FILE_ATTRIBUTE_SPARSE_FILE) != 0)
+      && !::DeviceIoControl(destination, FSCTL_SET_SPARSE, nullptr, 0, nullptr, 0, &bytesReturned, nullptr)) {
+    return false;
+  }
+
+  LARGE_INTEGER size;
+  if (!::GetFileSizeEx(source, &size)) {
+    return false;
+  }
+  FILE_END_OF_FILE_INFO endOfFile;
+  endOfFile.EndOfFile = size;
+  if (!::SetFileInformationByHandle(destination, FileEndOfFileInfo, &endOfFile, sizeof(endOfFile))) {
+    return false;
+  }
+
+  // ranges have to be cluster aligned. The last one may extend past the end of file
+  const LONGLONG clusterSize = integrity.ClusterSizeInBytes;
+  const LONGLONG maxChunk = (LONGLONG(1) << 31) / clusterSize * clusterSize;
+  for (LONGLONG offset = 0; offset < size.QuadPart; offset += maxChunk) {
+    LONGLONG remaining = (size.QuadPart - offset + clusterSize - 1) / clusterSize * clusterSize;
+    DUPLICATE_EXTENTS_DATA extents;
+    extents.FileHandle = source;
+    extents.SourceFileOffset.QuadPart = offset;
+    extents.TargetFileOffset.QuadPart = offset;
+    extents.ByteCount.QuadPart = std::min(remaining, maxChunk);
+    if (!::DeviceIoControl(destination, FSCTL_DUPLICATE_EXTENTS_TO_FILE, &extents, sizeof(extents),
+                           nullptr, 0, &bytesReturned, nullptr)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+} // namespace
+
+#endif
+
+
+bool supportsCloning(const QString &source, const QString &destination)
+{
+  QStorageInfo sourceStorage(source);
+  if (!sourceStorage.isValid() || !(sourceStorage == QStorageInfo(destination))) {
+    return false;
+  }
+
+#if defined(Q_OS_WIN) && defined(FSCTL_DUPLICATE_EXTENTS_TO_FILE)
+  DWORD flags = 0;
+  std::wstring root = QDir::toNativeSeparators(sourceStorage.rootPath()).toStdWString();
+  if (!root.empty() && (root.back() != L'\\')) {
+    root.push_back(L'\\');
+  }
+  if (!::GetVolumeInformationW(root.c_str(), nullptr, 0, nullptr, nullptr, &flags, nullptr, 0)) {
+    return false;
+  }
+  return (flags & FILE_SUPPORTS_BLOCK_REFCOUNTING) != 0;
+#elif defined(Q_OS_LINUX) && defined(FICLONE)
+  // there is no flag to query, try it out
+  QTemporaryFile probe(source + "/nmmimport_clone_probe");
+  if (!probe.open() || (probe.write("probe", 5) != 5) || !probe.flush()) {
+    return false;
+  }
+  QString clonePath = destination + "/nmmimport_clone_probe.clone";
+  bool result = cloneFile(probe.fileName(), clonePath);
+  QFile::remove(clonePath);
+  return result;
+#else
+  return false;
+#endif
+}
+
+
+bool cloneFile(const QString &source, const QString &destination)
+{
+#if defined(Q_OS_WIN) && defined(FSCTL_DUPLICATE_EXTENTS_TO_FILE)
+  HandleGuard sourceHandle(::CreateFileW(QDir::toNativeSeparators(source).toStdWString().c_str(),
+                                         GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, 0, nullptr));
+  if (!sourceHandle.isValid()) {
+    return false;
+  }
+  HandleGuard destinationHandle(::CreateFileW(QDir::toNativeSeparators(destination).toStdWString().c_str(),
+                                              GENERIC_READ | GENERIC_WRITE | DELETE, 0, nullptr, CREATE_NEW, 0, nullptr));
+  if (!destinationHandle.isValid()) {
+    return false;
+  }
+  if (!duplicateExtents(sourceHandle.get(), destinationHandle.get())) {
+    FILE_DISPOSITION_INFO disposition = { TRUE };
+    ::SetFileInformationByHandle(destinationHandle.get(), FileDispositionInfo, &disposition, sizeof(disposition));
+    return false;
+  }
+  return true;
+#elif defined(Q_OS_LINUX) && defined(FICLONE)
+  int sourceFD = ::open(QFile::encodeName(source).constData(), O_RDONLY);
+  if (sourceFD == -1) {
+    return false;
+  }
+  int destinationFD = ::open(QFile::encodeName(destination).constData(), O_WRONLY | O_CREAT | O_EXCL, 0644);
+  if (destinationFD == -1) {
+    ::close(sourceFD);
+    return false;
+  }
+  bool result = ::ioctl(destinationFD, FICLONE, sourceFD) == 0;
+  ::close(destinationFD);
+  ::close(sourceFD);
+  if (!result) {
+    QFile::remove(destination);
+  }
+  return result;
+#else
+  Q_UNUSED(source);
+  Q_UNUSED(destination);
+  return false;
+#endif
+}
+
+
+bool linkFile(const QString &source, const QString &destination)
+{
+#ifdef Q_OS_WIN
+  return ::CreateHardLinkW(QDir::toNativeSeparators(destination).toStdWString().c_str(),
+                           QDir::toNativeSeparators(source).toStdWString().c_str(), nullptr) != 0;
+#else
+  return ::link(QFile::encodeName(source).constData(), QFile::encodeName(destination).constData()) == 0;
+#endif
+}
@@ -0,0 +1,54 @@
+/*
+Copyright (C) 2012 Sebastian Herbord. All rights reserved.
+
+This file is part of NMM Import plugin for MO
+
+NMM Import plugin is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+NMM Import plugin is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with NMM Import plugin.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef FILECLONE_H
+#define FILECLONE_H
+
+#include <QString>
+
+
+/**
+ * @brief determine whether files can be cloned from one directory to the other
+ *
+ * Cloning (ReFS block cloning on windows, reflinks on linux) creates a copy that shares
+ * the data blocks with the original until either is modified. It requires both
+ * directories to be on the same volume.
+ * @param source directory files would be cloned from
+ * @param destination directory clones would be created in
+ */
+bool supportsCloning(const QString &source, const QString &destination);
+
+/**
+ * @brief create a copy-on-write clone of a file
+ * @param source the file to clone
+ * @param destination path of the clone, must not exist yet
+ * @return false if the file couldn't be cloned. No destination file is left behind in that case
+ */
+bool cloneFile(const QString &source, const QString &destination);
+
+/**
+ * @brief create a hard link to a file
+ * @param source the existing file
+ * @param destination path of the new link, must not exist yet and has to be on the same volume
+ * @return false if the link couldn't be created, i.e. because the file system doesn't
+ *         support hard links
+ */
+bool linkFile(const QString &source, const QString &destination);
+
+#endif // FILECLONE_H
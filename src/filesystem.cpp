@@ -0,0 +1,190 @@
+/*
+Copyright (C) 2012 Sebastian Herbord. All rights reserved.
+
+This file is part of NMM Import plugin for MO
+
+NMM Import plugin is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+NMM Import plugin is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with NMM Import plugin.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "filesystem.h"
+#include "batchdelete.h"
+#include "fileclone.h"
+
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QStorageInfo>
+
+
+namespace {
+
+class RealFileSystem : public FileSystem
+{
+public:
+
+  virtual EType type(const QString &path) const
+  {
+    QFileInfo info(path);
+    return !info.exists() ? TYPE_NONE : info.isDir() ? TYPE_DIRECTORY : TYPE_FILE;
+  }
+
+  virtual qint64 fileSize(const QString &path) const
+  {
+    QFileInfo info(path);
+    return info.exists() ? info.size() : -1;
+  }
+
+  virtual QStringList entries(const QString &directory) const
+  {
+    return QDir(directory).entryList(QDir::AllEntries | QDir::NoDotAndDotDot | QDir::Hidden | QDir::System);
+  }
+
+  virtual QString volume(const QString &path) const
+  {
+    return QStorageInfo(path).rootPath();
+  }
+
+  virtual qint64 bytesAvailable(const QString &path) const
+  {
+    return QStorageInfo(path).bytesAvailable();
+  }
+
+  virtual bool supportsCloning(const QString &source, const QString &destination) const
+  {
+    return ::supportsCloning(source, destination);
+  }
+
+  virtual bool renameFile(const QString &source, const QString &destination, QString &error)
+  {
+    QFile file(source);
+    if (!file.rename(destination)) {
+      error = file.errorString();
+      return false;
+    }
+    return true;
+  }
+
+  virtual bool copyFile(const QString &source, const QString &destination, QString &error)
+  {
+    QFile file(source);
+    if (!file.copy(destination)) {
+      error = file.errorString();
+      return false;
+    }
+    return true;
+  }
+
+  virtual bool removeFile(const QString &path, QString &error)
+  {
+    QFile file(path);
+    if (!file.remove()) {
+      error = file.errorString();
+      return false;
+    }
+    return true;
+  }
+
+  virtual bool cloneFile(const QString &source, const QString &destination)
+  {
+    return ::cloneFile(source, destination);
+  }
+
+  virtual bool linkFile(const QString &source, const QString &destination)
+  {
+    return ::linkFile(source, destination);
+  }
+
+  virtual bool renameDirectory(const QString &source, const QString &destination)
+  {
+    return QDir().rename(source, destination);
+  }
+
+  virtual bool makeDirectory(const QString &directory)
+  {
+    return QDir().mkdir(directory);
+  }
+
+  virtual bool removeDirectory(const QString &directory)
+  {
+    return QDir().rmdir(directory);
+  }
+
+  virtual std::vector<QString> removeFiles(const QStringList &files, unsigned int concurrency)
+  {
+    return deleteFiles(files, concurrency);
+  }
+
+  virtual bool replaceFile(const QString &path, const std::function<bool (QIODevice&)> &writer)
+  {
+    // QSaveFile writes to a temporary file and only replaces the target, after syncing
+    // it to disk, on commit
+    QSaveFile file(path);
+    return file.open(QIODevice::WriteOnly) && writer(file) && file.commit();
+  }
+
+  virtual bool writeFile(const QString &path, const std::function<bool (QIODevice&)> &writer)
+  {
+    QFile file(path);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+      return false;
+    }
+    bool res = writer(file) && file.flush();
+    file.close();
+    return res;
+  }
+
+};
+
+} // namespace
+
+
+FileSystem &FileSystem::real()
+{
+  static RealFileSystem instance;
+  return instance;
+}
+
+bool FileSystem::makePath(const QString &directory)
+{
+  switch (type(directory)) {
+    case TYPE_DIRECTORY: return true;
+    case TYPE_FILE:      return false;
+    default: {
+      // a missing root can't be created
+      QString parent = QFileInfo(directory).absolutePath();
+      return (parent != directory) && makePath(parent) && makeDirectory(directory);
+    }
+  }
+}
+
+qint64 FileSystem::directorySize(const QString &directory, int &fileCount) const
+{
+  qint64 result = 0;
+  fileCount = 0;
+  QStringList pending(directory);
+  while (!pending.isEmpty()) {
+    QString current = pending.takeLast();
+    foreach (const QString &entry, entries(current)) {
+      QString path = current + "/" + entry;
+      if (type(path) == TYPE_DIRECTORY) {
+        pending.append(path);
+      } else {
+        result += qMax<qint64>(fileSize(path), 0);
+        ++fileCount;
+      }
+    }
+  }
+  return result;
+}
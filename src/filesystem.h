@@ -0,0 +1,149 @@
+/*
+Copyright (C) 2012 Sebastian Herbord. All rights reserved.
+
+This file is part of NMM Import plugin for MO
+
+NMM Import plugin is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+NMM Import plugin is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with NMM Import plugin.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef FILESYSTEM_H
+#define FILESYSTEM_H
+
+#include <QByteArray>
+#include <QIODevice>
+#include <QString>
+#include <QStringList>
+#include <functional>
+#include <vector>
+
+
+/**
+ * @brief the file operations the import is built on
+ *
+ * All transfers go through this interface so the pipeline can be run against something
+ * other than the disk, i.e. MemoryFileSystem for benchmarks. Paths are absolute and use
+ * '/' as separator. Implementations have to be safe to call from several threads.
+ */
+class FileSystem
+{
+public:
+
+  enum EType {
+    TYPE_NONE,
+    TYPE_FILE,
+    TYPE_DIRECTORY
+  };
+
+public:
+
+  virtual ~FileSystem() {}
+
+  /**
+   * @return the file system backed by the disk
+   */
+  static FileSystem &real();
+
+  virtual EType type(const QString &path) const = 0;
+
+  /**
+   * @return size of the file or -1 if it doesn't exist
+   */
+  virtual qint64 fileSize(const QString &path) const = 0;
+
+  /**
+   * @return names of the files and directories in the directory, hidden ones included
+   */
+  virtual QStringList entries(const QString &directory) const = 0;
+
+  /**
+   * @return root of the volume the path is on. Paths with the same root are on the same volume
+   */
+  virtual QString volume(const QString &path) const = 0;
+
+  /**
+   * @return space available to the user on the volume of the path, -1 if unknown
+   */
+  virtual qint64 bytesAvailable(const QString &path) const = 0;
+
+  /**
+   * @return true if files can be cloned from one directory to the other, see cloneFile
+   */
+  virtual bool supportsCloning(const QString &source, const QString &destination) const = 0;
+
+  virtual bool renameFile(const QString &source, const QString &destination, QString &error) = 0;
+  virtual bool copyFile(const QString &source, const QString &destination, QString &error) = 0;
+  virtual bool removeFile(const QString &path, QString &error) = 0;
+
+  /**
+   * @brief create a copy-on-write clone of a file
+   * @return false if the file can't be cloned, nothing is left behind in that case
+   */
+  virtual bool cloneFile(const QString &source, const QString &destination) = 0;
+
+  /**
+   * @brief create a hard link to a file
+   */
+  virtual bool linkFile(const QString &source, const QString &destination) = 0;
+
+  /**
+   * @brief rename a directory, fails if that isn't possible without moving the content
+   */
+  virtual bool renameDirectory(const QString &source, const QString &destination) = 0;
+
+  /**
+   * @brief create a directory, its parent has to exist
+   */
+  virtual bool makeDirectory(const QString &directory) = 0;
+
+  /**
+   * @brief remove a directory, fails if it isn't empty
+   */
+  virtual bool removeDirectory(const QString &directory) = 0;
+
+  /**
+   * @brief remove many files, possibly in parallel
+   * @param concurrency maximum number of removals in flight at the same time
+   * @return one entry per file, empty if the file was removed, the reason otherwise
+   */
+  virtual std::vector<QString> removeFiles(const QStringList &files, unsigned int concurrency) = 0;
+
+  /**
+   * @brief replace the content of a file so that readers see either the old or the new
+   *        content, even if the process dies in between
+   * @param writer called with the device to write the new content to. If it returns
+   *        false the file is left untouched
+   */
+  virtual bool replaceFile(const QString &path, const std::function<bool (QIODevice&)> &writer) = 0;
+
+  /**
+   * @brief write a file in place, replacing an existing one
+   * @note nothing is synced to disk, only for files that can simply be written again if
+   *       the process dies in between
+   */
+  virtual bool writeFile(const QString &path, const std::function<bool (QIODevice&)> &writer) = 0;
+
+  /**
+   * @brief create a directory and all missing parents
+   */
+  bool makePath(const QString &directory);
+
+  /**
+   * @param fileCount receives the number of files below the directory
+   * @return accumulated size of all files below the directory
+   */
+  qint64 directorySize(const QString &directory, int &fileCount) const;
+
+};
+
+#endif // FILESYSTEM_H
@@ -0,0 +1,461 @@
+/*
+Copyright (C) 2012 Sebastian Herbord. All rights reserved.
+
+This file is part of NMM Import plugin for MO
+
+NMM Import plugin is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+NMM Import plugin is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with NMM Import plugin.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "filetransaction.h"
+#include "batchdelete.h"
+#include "parallel.h"
+
+#include <QElapsedTimer>
+#include <QFileInfo>
+#include <algorithm>
+#include <atomic>
+
+
+namespace {
+
+// removals are handed to the file system in slices so a cancel request doesn't have
+// to wait for all of them
+const int REMOVE_SLICE_SIZE = 4096;
+
+}
+
+
+FileTransaction::FileTransaction(FileSystem &fileSystem)
+  : m_FileSystem(fileSystem)
+{
+  commit();
+}
+
+bool FileTransaction::move(const QString &source, const QString &destination)
+{
+  if (m_FileSystem.type(source) != FileSystem::TYPE_DIRECTORY) {
+    return moveFile(source, destination);
+  }
+
+  if (renameDirectory(source, destination)) {
+    return true;
+  }
+
+  // different volume or the destination exists already
+  if (!makePath(destination)) {
+    return false;
+  }
+  foreach (const QString &entry, m_FileSystem.entries(source)) {
+    if (!move(source + "/" + entry, destination + "/" + entry)) {
+      return false;
+    }
+  }
+  return removeDirectory(source);
+}
+
+bool FileTransaction::copy(const QString &source, const QString &destination)
+{
+  if (m_FileSystem.type(source) != FileSystem::TYPE_DIRECTORY) {
+    return copyFile(source, destination);
+  }
+
+  // the directory structure is created first, the files are then copied several at a time
+  std::vector<Transfer> transfers;
+  return listCopies(source, destination, QString(), transfers)
+      && copyFiles(transfers);
+}
+
+bool FileTransaction::remove(const QString &path, const QString &copy)
+{
+  if (m_FileSystem.type(path) != FileSystem::TYPE_DIRECTORY) {
+    return removeFile(path, copy);
+  }
+
+  foreach (const QString &entry, m_FileSystem.entries(path)) {
+    if (!remove(path + "/" + entry, copy + "/" + entry)) {
+      return false;
+    }
+  }
+  return removeDirectory(path);
+}
+
+bool FileTransaction::renameDirectory(const QString &source, const QString &destination)
+{
+  if (cancelled() || !makePath(QFileInfo(destination).absolutePath())) {
+    return false;
+  }
+  if (!m_FileSystem.renameDirectory(source, destination)) {
+    m_ErrorString = tr("failed to rename \"%1\" to \"%2\"").arg(source, destination);
+    return false;
+  }
+  record(OP_MOVEDIRECTORY, source, destination);
+  return true;
+}
+
+bool FileTransaction::moveFile(const QString &source, const QString &destination)
+{
+  if (cancelled() || !makePath(QFileInfo(destination).absolutePath())) {
+    return false;
+  }
+  QString error;
+  if (!m_FileSystem.renameFile(source, destination, error)) {
+    m_ErrorString = tr("failed to move \"%1\" to \"%2\": %3").arg(source, destination, error);
+    return false;
+  }
+  record(OP_MOVEFILE, source, destination);
+  return true;
+}
+
+bool FileTransaction::moveFile(const Transfer &transfer)
+{
+  QString source = transfer.source();
+  QString destination = transfer.destination();
+  if (cancelled() || !makePath(QFileInfo(destination).absolutePath())) {
+    return false;
+  }
+  QString error;
+  if (!m_FileSystem.renameFile(source, destination, error)) {
+    m_ErrorString = tr("failed to move \"%1\" to \"%2\": %3").arg(source, destination, error);
+    return false;
+  }
+  record(OP_MOVEFILE, transfer);
+  return true;
+}
+
+bool FileTransaction::copyFile(const QString &source, const QString &destination)
+{
+  if (cancelled() || !makePath(QFileInfo(destination).absolutePath())) {
+    return false;
+  }
+  QString error;
+  if (!transferFile(source, destination, error)) {
+    m_ErrorString = tr("failed to copy \"%1\" to \"%2\": %3").arg(source, destination, error);
+    return false;
+  }
+  record(OP_COPYFILE, source, destination);
+  return true;
+}
+
+bool FileTransaction::copyFiles(const std::vector<Transfer> &transfers)
+{
+  int total = static_cast<int>(transfers.size());
+  for (int offset = 0; offset < total; offset += COPY_SLICE_SIZE) {
+    if (cancelled()) {
+      return false;
+    }
+    int count = std::min<int>(COPY_SLICE_SIZE, total - offset);
+
+    // directories are journaled, create them up front and in order
+    std::vector<QString> sources(count);
+    std::vector<QString> destinations(count);
+    for (int index = 0; index < count; ++index) {
+      sources[index] = transfers[offset + index].source();
+      destinations[index] = transfers[offset + index].destination();
+      if (!makePath(QFileInfo(destinations[index]).absolutePath())) {
+        return false;
+      }
+    }
+
+    unsigned int sliceConcurrency = concurrency();
+    std::vector<char> copied(count, 0);
+    std::vector<QString> errors(count);
+    std::atomic<qint64> bytes(0);
+    QElapsedTimer timer;
+    timer.start();
+    parallelFor(count, sliceConcurrency, [&] (size_t index) {
+      // skip the rest of the slice once cancelled, the copies made so far are journaled
+      if (isCancelled()) {
+        return;
+      }
+      if (transferFile(sources[index], destinations[index], errors[index])) {
+        copied[index] = 1;
+        bytes += std::max<qint64>(0, m_FileSystem.fileSize(destinations[index]));
+      }
+    });
+    if (m_Concurrency != nullptr) {
+      int done = static_cast<int>(std::count(copied.begin(), copied.end(), 1));
+      m_Concurrency->record(done, bytes, timer.nsecsElapsed() / 1000, sliceConcurrency);
+    }
+
+    bool failed = false;
+    for (int index = 0; index < count; ++index) {
+      if (copied[index]) {
+        record(OP_COPYFILE, transfers[offset + index]);
+      } else if (!failed) {
+        if (!cancelled()) {
+          m_ErrorString = tr("failed to copy \"%1\" to \"%2\": %3").arg(sources[index], destinations[index], errors[index]);
+        }
+        failed = true;
+      }
+    }
+    if (failed) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool FileTransaction::removeFile(const QString &path, const QString &copy)
+{
+  if (cancelled()) {
+    return false;
+  }
+  QString error;
+  if (!m_FileSystem.removeFile(path, error)) {
+    m_ErrorString = tr("failed to remove \"%1\": %2").arg(path, error);
+    return false;
+  }
+  record(OP_REMOVEFILE, path, copy);
+  return true;
+}
+
+bool FileTransaction::removeFiles(const QStringList &paths, const QStringList &copies, const QString &root,
+                                  QStringList &failures)
+{
+  std::vector<QString> errors;
+  errors.reserve(paths.size());
+  for (int offset = 0; offset < paths.size(); offset += REMOVE_SLICE_SIZE) {
+    if (cancelled()) {
+      errors.resize(paths.size(), m_ErrorString);
+      break;
+    }
+    unsigned int sliceConcurrency = concurrency();
+    QElapsedTimer timer;
+    timer.start();
+    std::vector<QString> sliceErrors = m_FileSystem.removeFiles(paths.mid(offset, REMOVE_SLICE_SIZE), sliceConcurrency);
+    if (m_Concurrency != nullptr) {
+      m_Concurrency->record(static_cast<int>(sliceErrors.size()), 0, timer.nsecsElapsed() / 1000, sliceConcurrency);
+    }
+    errors.insert(errors.end(), sliceErrors.begin(), sliceErrors.end());
+  }
+
+  QStringList directories;
+  QString lastDirectory;
+  for (int i = 0; i < paths.size(); ++i) {
+    if (errors[i].isEmpty()) {
+      record(OP_REMOVEFILE, paths.at(i), copies.at(i));
+      QString directory = paths.at(i).left(paths.at(i).lastIndexOf('/'));
+      if (directory != lastDirectory) {
+        directories.append(directory);
+        lastDirectory = directory;
+      }
+    } else {
+      failures.append(tr("%1: %2").arg(paths.at(i), errors[i]));
+    }
+  }
+
+  foreach (const QString &directory, pruneEmptyDirectories(m_FileSystem, directories, root)) {
+    record(OP_REMOVEDIRECTORY, directory);
+  }
+  m_LastDirectory.clear();
+
+  if (!failures.isEmpty()) {
+    if (!isCancelled()) {
+      m_ErrorString = tr("failed to remove %1 file(s)").arg(failures.size());
+    }
+    return false;
+  }
+  return true;
+}
+
+bool FileTransaction::removeCopySources(size_t savepoint, const QString &root, QStringList &failures)
+{
+  QStringList paths;
+  QStringList copies;
+  for (size_t i = savepoint; i < m_Journal.size(); ++i) {
+    if (m_Journal[i].operation == OP_COPYFILE) {
+      paths.append(source(m_Journal[i]));
+      copies.append(destination(m_Journal[i]));
+    }
+  }
+  return removeFiles(paths, copies, root, failures);
+}
+
+bool FileTransaction::makePath(const QString &directory)
+{
+  // files are usually processed directory by directory, this saves most of the lookups
+  if (directory == m_LastDirectory) {
+    return true;
+  }
+
+  FileSystem::EType type = m_FileSystem.type(directory);
+  if (type == FileSystem::TYPE_NONE) {
+    // create the parents first so each created directory gets its own entry
+    QString parent = QFileInfo(directory).absolutePath();
+    if (parent == directory) {
+      m_ErrorString = tr("\"%1\" doesn't exist and can't be created").arg(directory);
+      return false;
+    }
+    if (!makePath(parent)) {
+      return false;
+    }
+    if (!m_FileSystem.makeDirectory(directory)) {
+      m_ErrorString = tr("failed to create directory \"%1\"").arg(directory);
+      return false;
+    }
+    record(OP_MAKEDIRECTORY, directory);
+  } else if (type != FileSystem::TYPE_DIRECTORY) {
+    m_ErrorString = tr("\"%1\" exists but is not a directory").arg(directory);
+    return false;
+  }
+  m_LastDirectory = directory;
+  return true;
+}
+
+bool FileTransaction::removeDirectory(const QString &directory)
+{
+  if (!m_FileSystem.removeDirectory(directory)) {
+    m_ErrorString = tr("failed to remove directory \"%1\"").arg(directory);
+    return false;
+  }
+  record(OP_REMOVEDIRECTORY, directory);
+  return true;
+}
+
+bool FileTransaction::cancelled()
+{
+  if ((m_Cancel != nullptr) && m_Cancel->isCancelled()) {
+    m_ErrorString = tr("cancelled by the user");
+    return true;
+  }
+  return false;
+}
+
+bool FileTransaction::listCopies(const QString &source, const QString &destination, const QString &relativePath,
+                                 std::vector<Transfer> &transfers)
+{
+  QString directory = relativePath.isEmpty() ? QString() : relativePath + "/";
+  if (!makePath(destination + "/" + relativePath)) {
+    return false;
+  }
+  foreach (const QString &entry, m_FileSystem.entries(source + "/" + relativePath)) {
+    QString entryPath = directory + entry;
+    if (m_FileSystem.type(source + "/" + entryPath) == FileSystem::TYPE_DIRECTORY) {
+      if (!listCopies(source, destination, entryPath, transfers)) {
+        return false;
+      }
+    } else {
+      Transfer transfer = { source + "/", destination + "/", NormalizedPath(entryPath) };
+      transfers.push_back(transfer);
+    }
+  }
+  return true;
+}
+
+unsigned int FileTransaction::concurrency() const
+{
+  return m_Concurrency != nullptr ? m_Concurrency->concurrency() : workerCount();
+}
+
+bool FileTransaction::transferFile(const QString &source, const QString &destination, QString &error)
+{
+  // clones are attempted first, files that can't be cloned are copied regularly
+  return (m_CloneFiles && m_FileSystem.cloneFile(source, destination))
+      || m_FileSystem.copyFile(source, destination, error);
+}
+
+void FileTransaction::record(EOperation operation, const QString &source, const QString &destination)
+{
+  // the tail both paths have in common, starting behind a separator, is stored once. A
+  // single path is split at its last separator so files in a directory share the base
+  int separator = -1;
+  if (destination.isEmpty()) {
+    separator = source.lastIndexOf('/');
+  } else {
+    int common = 0;
+    int maxCommon = std::min(source.size(), destination.size());
+    while ((common < maxCommon)
+           && (source.at(source.size() - 1 - common) == destination.at(destination.size() - 1 - common))) {
+      ++common;
+    }
+    separator = source.indexOf('/', source.size() - common);
+  }
+  int relativeSize = separator != -1 ? source.size() - separator - 1 : 0;
+  Entry entry = {
+    operation,
+    baseIndex(source.left(source.size() - relativeSize)),
+    baseIndex(destination.left(std::max(0, destination.size() - relativeSize))),
+    NormalizedPath(source.right(relativeSize))
+  };
+  m_Journal.push_back(entry);
+}
+
+void FileTransaction::record(EOperation operation, const Transfer &transfer)
+{
+  Entry entry = { operation, baseIndex(transfer.sourceBase), baseIndex(transfer.destinationBase), transfer.path };
+  m_Journal.push_back(entry);
+}
+
+quint32 FileTransaction::baseIndex(const QString &base)
+{
+  auto iter = m_BaseIndex.find(base);
+  if (iter != m_BaseIndex.end()) {
+    return *iter;
+  }
+  quint32 index = static_cast<quint32>(m_Bases.size());
+  m_Bases.push_back(base);
+  m_BaseIndex.insert(base, index);
+  return index;
+}
+
+QString FileTransaction::source(const Entry &entry) const
+{
+  return QString(m_Bases[entry.sourceBase]).append(entry.path.relative());
+}
+
+QString FileTransaction::destination(const Entry &entry) const
+{
+  return QString(m_Bases[entry.destinationBase]).append(entry.path.relative());
+}
+
+bool FileTransaction::undo(const Entry &entry)
+{
+  QString error;
+  QString source = this->source(entry);
+  QString destination = this->destination(entry);
+  switch (entry.operation) {
+    case OP_MOVEFILE:         return m_FileSystem.renameFile(destination, source, error);
+    case OP_MOVEDIRECTORY:    return m_FileSystem.renameDirectory(destination, source);
+    case OP_COPYFILE:         return m_FileSystem.removeFile(destination, error);
+    case OP_REMOVEFILE:       return m_FileSystem.copyFile(destination, source, error);
+    case OP_MAKEDIRECTORY:    return m_FileSystem.removeDirectory(source);
+    case OP_REMOVEDIRECTORY:  return m_FileSystem.makeDirectory(source);
+    default:                  return false;
+  }
+}
+
+bool FileTransaction::rollback(size_t savepoint)
+{
+  bool result = true;
+  while (m_Journal.size() > savepoint) {
+    const Entry &entry = m_Journal.back();
+    if (!undo(entry)) {
+      qWarning("failed to undo operation %d on \"%s\" (\"%s\")", entry.operation,
+               qPrintable(source(entry)), qPrintable(destination(entry)));
+      result = false;
+    }
+    m_Journal.pop_back();
+  }
+  // directories may have been removed
+  m_LastDirectory.clear();
+  return result;
+}
+
+void FileTransaction::commit()
+{
+  std::vector<Entry>().swap(m_Journal);
+  m_Bases.clear();
+  m_BaseIndex.clear();
+  baseIndex(QString());
+}
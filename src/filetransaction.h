@@ -0,0 +1,234 @@
+/*
+Copyright (C) 2012 Sebastian Herbord. All rights reserved.
+
+This file is part of NMM Import plugin for MO
+
+NMM Import plugin is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+NMM Import plugin is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with NMM Import plugin.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef FILETRANSACTION_H
+#define FILETRANSACTION_H
+
+#include "cancellation.h"
+#include "concurrencycontroller.h"
+#include "filesystem.h"
+#include "normalizedpath.h"
+
+#include <QCoreApplication>
+#include <QHash>
+#include <QString>
+#include <QStringList>
+#include <vector>
+
+
+/**
+ * @brief performs file operations and journals them so they can be undone
+ *
+ * Every successful operation appends one entry to the journal. Entries store their paths
+ * as the index of a base directory, kept once per transaction, plus the path below it,
+ * which shares its data with the NormalizedPath it came from. Keeping the journal
+ * therefore costs little more than the file lists it was built from. Rolling back undoes
+ * the operations in reverse order.
+ * All operations, undo included, go through the file system passed on construction.
+ */
+class FileTransaction
+{
+
+  Q_DECLARE_TR_FUNCTIONS(FileTransaction)
+
+public:
+
+  /**
+   * @brief a file given by two base directories and its path below both of them
+   */
+  struct Transfer {
+    QString sourceBase;      // ends on a '/'
+    QString destinationBase; // ends on a '/'
+    NormalizedPath path;     // its relative part is appended to the bases
+
+    QString source() const { return QString(sourceBase).append(path.relative()); }
+    QString destination() const { return QString(destinationBase).append(path.relative()); }
+  };
+
+  // number of files copied per slice by copyFiles. Copies take longer than removals,
+  // smaller slices keep cancelling and the concurrency adjustments responsive. Callers
+  // producing copies on the fly can hand them over in slices of this size
+  enum { COPY_SLICE_SIZE = 64 };
+
+public:
+
+  explicit FileTransaction(FileSystem &fileSystem = FileSystem::real());
+
+  /**
+   * @brief move a file or directory. Directories are renamed if possible, their content
+   *        is moved file by file otherwise
+   */
+  bool move(const QString &source, const QString &destination);
+
+  /**
+   * @brief copy a file or directory with all its content. The files of a directory are
+   *        copied through copyFiles
+   */
+  bool copy(const QString &source, const QString &destination);
+
+  /**
+   * @brief remove a file or directory with all its content
+   * @param path the file or directory to remove
+   * @param copy an identical copy of path, used to restore it on rollback
+   */
+  bool remove(const QString &path, const QString &copy);
+
+  /**
+   * @brief rename a directory without falling back to moving its content
+   * @return false if the directory can't be renamed, i.e. because the destination is
+   *         on a different volume
+   */
+  bool renameDirectory(const QString &source, const QString &destination);
+
+  /**
+   * @brief remove an empty directory
+   */
+  bool removeDirectory(const QString &directory);
+
+  bool moveFile(const QString &source, const QString &destination);
+  bool moveFile(const Transfer &transfer);
+  bool copyFile(const QString &source, const QString &destination);
+  bool removeFile(const QString &path, const QString &copy);
+
+  /**
+   * @brief copy many files, several at a time
+   *
+   * Stops after the slice in which the first copy failed, the copies that succeeded up
+   * to that point stay in the journal.
+   * @param transfers the files to copy
+   */
+  bool copyFiles(const std::vector<Transfer> &transfers);
+
+  /**
+   * @brief make copyFile (and copy) create copy-on-write clones where possible. Files that
+   *        can't be cloned are still copied regularly
+   */
+  void setCloneFiles(bool clone) { m_CloneFiles = clone; }
+
+  /**
+   * @brief make operations fail once the token is cancelled. Rollback is never cancelled
+   */
+  void setCancellationToken(const CancellationToken *cancel) { m_Cancel = cancel; }
+
+  /**
+   * @brief let the controller decide how many files are copied or removed at the same
+   *        time and report the throughput of each slice to it. Without a controller
+   *        workerCount() operations run concurrently
+   */
+  void setConcurrencyController(ConcurrencyController *controller) { m_Concurrency = controller; }
+
+  /**
+   * @return true if the cancellation token was set
+   */
+  bool isCancelled() const { return (m_Cancel != nullptr) && m_Cancel->isCancelled(); }
+
+  /**
+   * @brief remove many files in parallel, then remove directories left empty
+   * @param paths the files to remove, using '/' as separator
+   * @param copies identical copies of the files, used to restore them on rollback
+   * @param root directories are only removed below this one
+   * @param failures receives a description for each file that couldn't be removed
+   * @return true if all files were removed
+   */
+  bool removeFiles(const QStringList &paths, const QStringList &copies, const QString &root,
+                   QStringList &failures);
+
+  /**
+   * @brief remove the sources of all files copied since a savepoint, see removeFiles
+   * @note the paths are taken from the journal so the caller doesn't have to keep
+   *       its own list of the copied files
+   */
+  bool removeCopySources(size_t savepoint, const QString &root, QStringList &failures);
+
+  /**
+   * @brief create a directory and all missing parents
+   */
+  bool makePath(const QString &directory);
+
+  /**
+   * @return position in the journal to pass to rollback later
+   */
+  size_t savepoint() const { return m_Journal.size(); }
+
+  /**
+   * @brief undo all operations after the savepoint, newest first
+   * @return true if everything was undone. Operations that can't be undone are logged
+   *         and skipped
+   */
+  bool rollback(size_t savepoint = 0);
+
+  /**
+   * @brief drop the journal once the operations don't have to be undone anymore
+   * @note savepoints taken before are invalid afterwards
+   */
+  void commit();
+
+  /**
+   * @return description of the last failed operation
+   */
+  QString errorString() const { return m_ErrorString; }
+
+private:
+
+  enum EOperation {
+    OP_MOVEFILE,
+    OP_MOVEDIRECTORY,
+    OP_COPYFILE,
+    OP_REMOVEFILE,
+    OP_MAKEDIRECTORY,
+    OP_REMOVEDIRECTORY
+  };
+
+  struct Entry {
+    EOperation operation;
+    quint32 sourceBase;
+    quint32 destinationBase;
+    NormalizedPath path;
+  };
+
+private:
+
+  void record(EOperation operation, const QString &source, const QString &destination = QString());
+  void record(EOperation operation, const Transfer &transfer);
+  quint32 baseIndex(const QString &base);
+  QString source(const Entry &entry) const;
+  QString destination(const Entry &entry) const;
+  bool undo(const Entry &entry);
+  bool cancelled();
+  bool listCopies(const QString &source, const QString &destination, const QString &relativePath,
+                  std::vector<Transfer> &transfers);
+  unsigned int concurrency() const;
+  bool transferFile(const QString &source, const QString &destination, QString &error);
+
+private:
+
+  FileSystem &m_FileSystem;
+  std::vector<Entry> m_Journal;
+  // base directories of the journal entries, the first one is empty
+  std::vector<QString> m_Bases;
+  QHash<QString, quint32> m_BaseIndex;
+  QString m_ErrorString;
+  QString m_LastDirectory;
+  bool m_CloneFiles { false };
+  const CancellationToken *m_Cancel { nullptr };
+  ConcurrencyController *m_Concurrency { nullptr };
+
+};
+
+#endif // FILETRANSACTION_H
@@ -0,0 +1,167 @@
+/*
+Copyright (C) 2012 Sebastian Herbord. All rights reserved.
+
+This file is part of NMM Import plugin for MO
+
+NMM Import plugin is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+NMM Import plugin is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with NMM Import plugin.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "importreport.h"
+
+#include <QDateTime>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QSaveFile>
+
+
+namespace {
+
+const char *strategyName(Preflight::EStrategy strategy)
+{
+  switch (strategy) {
+    case Preflight::STRATEGY_RENAME: return "rename";
+    case Preflight::STRATEGY_CLONE: return "clone";
+    default: return "copy";
+  }
+}
+
+const char *resultName(ImportReport::EResult result)
+{
+  switch (result) {
+    case ImportReport::RESULT_CANCELLED: return "cancelled";
+    case ImportReport::RESULT_FAILED: return "failed";
+    case ImportReport::RESULT_UNDONE: return "undone";
+    case ImportReport::RESULT_PARTIAL: return "partial";
+    case ImportReport::RESULT_SUCCESS: return "success";
+    default: return "skipped";
+  }
+}
+
+// bytes per second, 0 if the time is too short to measure
+double throughput(qint64 bytes, qint64 milliseconds)
+{
+  return milliseconds > 0 ? (bytes * 1000.0) / milliseconds : 0.0;
+}
+
+} // namespace
+
+
+ImportReport::ImportReport()
+{
+  m_Timer.start();
+}
+
+ImportReport::Mod &ImportReport::addMod(const QString &key, const QString &name)
+{
+  m_Mods.push_back(Mod());
+  m_Mods.back().key = key;
+  m_Mods.back().name = name;
+  return m_Mods.back();
+}
+
+ImportReport::Mod *ImportReport::findMod(const QString &key)
+{
+  for (auto iter = m_Mods.begin(); iter != m_Mods.end(); ++iter) {
+    if (iter->key == key) {
+      return &*iter;
+    }
+  }
+  return nullptr;
+}
+
+void ImportReport::setUndone(bool undone)
+{
+  m_Undone = undone;
+  if (undone) {
+    for (auto iter = m_Mods.begin(); iter != m_Mods.end(); ++iter) {
+      if ((iter->result == RESULT_SUCCESS) || (iter->result == RESULT_PARTIAL)) {
+        iter->result = RESULT_UNDONE;
+      }
+    }
+  }
+}
+
+bool ImportReport::write(const QString &fileName) const
+{
+  static const char *stageNames[STAGE_COUNT] = { "prepare", "transfer", "readme" };
+
+  int totalFiles = 0;
+  qint64 totalBytes = 0;
+  qint64 transferTime = 0;
+  int results[RESULT_SUCCESS + 1] = {};
+
+  QJsonArray mods;
+  for (auto iter = m_Mods.begin(); iter != m_Mods.end(); ++iter) {
+    QJsonObject stages;
+    for (int i = 0; i < STAGE_COUNT; ++i) {
+      stages[stageNames[i]] = static_cast<double>(iter->stageTimes[i]);
+    }
+
+    QJsonObject mod;
+    mod["key"] = iter->key;
+    mod["name"] = iter->name;
+    mod["result"] = resultName(iter->result);
+    mod["strategy"] = strategyName(iter->strategy);
+    mod["files"] = iter->files;
+    mod["bytes"] = static_cast<double>(iter->bytes);
+    mod["missingFiles"] = iter->missingFiles;
+    mod["overwrittenFiles"] = iter->overwrittenFiles;
+    mod["restoredFiles"] = iter->restoredFiles;
+    mod["stageTimesMs"] = stages;
+    mod["bytesPerSecond"] = throughput(iter->bytes, iter->stageTimes[STAGE_TRANSFER]);
+    if (!iter->error.isEmpty()) {
+      mod["error"] = iter->error;
+    }
+    mods.append(mod);
+
+    ++results[iter->result];
+    if ((iter->result == RESULT_SUCCESS) || (iter->result == RESULT_PARTIAL)) {
+      totalFiles += iter->files;
+      totalBytes += iter->bytes;
+      transferTime += iter->stageTimes[STAGE_TRANSFER];
+    }
+  }
+
+  QJsonObject totals;
+  totals["succeeded"] = results[RESULT_SUCCESS];
+  totals["partial"] = results[RESULT_PARTIAL];
+  totals["failed"] = results[RESULT_FAILED];
+  totals["undoneMods"] = results[RESULT_UNDONE];
+  totals["skipped"] = results[RESULT_SKIPPED];
+  totals["undone"] = m_Undone;
+  totals["cancelled"] = m_Cancelled;
+  totals["files"] = totalFiles;
+  totals["bytes"] = static_cast<double>(totalBytes);
+  totals["preflightMs"] = static_cast<double>(m_PreflightTime);
+  totals["transferMs"] = static_cast<double>(transferTime);
+  totals["logUpdateMs"] = static_cast<double>(m_LogUpdateTime);
+  totals["totalMs"] = static_cast<double>(m_Timer.elapsed());
+  totals["bytesPerSecond"] = throughput(totalBytes, transferTime);
+
+  QJsonObject report;
+  report["date"] = QDateTime::currentDateTimeUtc().toString(Qt::ISODate);
+  report["mods"] = mods;
+  report["totals"] = totals;
+  if (m_MemoryProfile != nullptr) {
+    report["memory"] = m_MemoryProfile->toJson();
+  }
+
+  QSaveFile file(fileName);
+  if (!file.open(QIODevice::WriteOnly)) {
+    return false;
+  }
+  file.write(QJsonDocument(report).toJson());
+  return file.commit();
+}
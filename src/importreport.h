@@ -0,0 +1,133 @@
+/*
+Copyright (C) 2012 Sebastian Herbord. All rights reserved.
+
+This file is part of NMM Import plugin for MO
+
+NMM Import plugin is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+NMM Import plugin is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with NMM Import plugin.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef IMPORTREPORT_H
+#define IMPORTREPORT_H
+
+#include "memoryprofile.h"
+#include "preflight.h"
+
+#include <QElapsedTimer>
+#include <QString>
+#include <vector>
+
+
+/**
+ * @brief machine readable summary of an import
+ *
+ * Records per mod what was transfered, how, and how long each stage took. Written as
+ * json once the import is done so imports on different machines can be compared.
+ */
+class ImportReport
+{
+public:
+
+  enum EStage {
+    STAGE_PREPARE,  // creating the mod and reading its meta data
+    STAGE_TRANSFER, // moving or copying the files
+    STAGE_README,   // extracting readmes
+    STAGE_COUNT
+  };
+
+  enum EResult {
+    RESULT_SKIPPED,
+    RESULT_CANCELLED, // the import was cancelled while the mod was transfered
+    RESULT_FAILED,
+    RESULT_UNDONE,    // imported, then rolled back when the user undid the whole import
+    RESULT_PARTIAL,
+    RESULT_SUCCESS
+  };
+
+  struct Mod {
+    QString key;
+    QString name;
+    Preflight::EStrategy strategy { Preflight::STRATEGY_COPY };
+    EResult result { RESULT_SKIPPED };
+    int files { 0 };
+    qint64 bytes { 0 };
+    int missingFiles { 0 };
+    int overwrittenFiles { 0 };
+    int restoredFiles { 0 }; // overwritten files extracted from the cached archive afterwards
+    QString error;
+    qint64 stageTimes[STAGE_COUNT] = {};
+  };
+
+public:
+
+  ImportReport();
+
+  /**
+   * @brief start the record of a mod
+   * @return the record, valid until the next call
+   */
+  Mod &addMod(const QString &key, const QString &name);
+
+  /**
+   * @return the record of the mod with the specified key, nullptr if there is none
+   */
+  Mod *findMod(const QString &key);
+
+  /**
+   * @brief time spent planning the transfer before any mod was imported
+   */
+  void setPreflightTime(qint64 milliseconds) { m_PreflightTime = milliseconds; }
+
+  /**
+   * @brief time spent updating the NMM log after the import
+   */
+  void setLogUpdateTime(qint64 milliseconds) { m_LogUpdateTime = milliseconds; }
+
+  /**
+   * @brief mark that the user chose to undo the whole import after a failure
+   * @note mods imported up to then are marked undone and don't count as transfered
+   */
+  void setUndone(bool undone);
+
+  /**
+   * @brief mark that the user cancelled the import before all selected mods were imported
+   */
+  void setCancelled(bool cancelled) { m_Cancelled = cancelled; }
+
+  /**
+   * @brief include the phases and structures recorded by the profile in the report
+   * @param profile the profile, nullptr if memory wasn't profiled. It has to exist until
+   *                the report is written
+   */
+  void setMemoryProfile(const MemoryProfile *profile) { m_MemoryProfile = profile; }
+
+  /**
+   * @brief write the report as json
+   * @param fileName the file to write, it is replaced if it exists
+   * @return false if the file couldn't be written
+   */
+  bool write(const QString &fileName) const;
+
+private:
+
+  std::vector<Mod> m_Mods;
+  QElapsedTimer m_Timer;
+  qint64 m_PreflightTime { 0 };
+  qint64 m_LogUpdateTime { 0 };
+  bool m_Undone { false };
+  bool m_Cancelled { false };
+  const MemoryProfile *m_MemoryProfile { nullptr };
+
+};
+
+#endif // IMPORTREPORT_H
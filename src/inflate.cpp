@@ -0,0 +1,377 @@
+/*
+Copyright (C) 2012 Sebastian Herbord. All rights reserved.
+
+This file is part of NMM Import plugin for MO
+
+NMM Import plugin is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+NMM Import plugin is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with NMM Import plugin.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "inflate.h"
+
+
+namespace {
+
+const int MAX_BITS = 15;
+const int MAX_LENGTH_CODES = 286;
+const int MAX_DISTANCE_CODES = 30;
+const int FIXED_LENGTH_CODES = 288;
+
+const short LENGTH_BASE[29] = {
+  3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+  35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+const short LENGTH_EXTRA[29] = {
+  0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+  3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+const short DISTANCE_BASE[30] = {
+  1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+  257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577 };
+const short DISTANCE_EXTRA[30] = {
+  0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+  7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+
+
+/**
+ * @brief canonical huffman code, stored as number of codes per length and the
+ *        symbols ordered by code
+ */
+struct Huffman {
+  short count[MAX_BITS + 1];
+  short symbol[FIXED_LENGTH_CODES];
+
+  /**
+   * @return 0 for a complete code, a positive number for an incomplete one and a
+   *         negative number for an over-subscribed one
+   */
+  int construct(const short *lengths, int symbolCount)
+  {
+    for (int length = 0; length <= MAX_BITS; ++length) {
+      count[length] = 0;
+    }
+    for (int i = 0; i < symbolCount; ++i) {
+      ++count[lengths[i]];
+    }
+    if (count[0] == symbolCount) {
+      return 0;
+    }
+
+    int left = 1;
+    for (int length = 1; length <= MAX_BITS; ++length) {
+      left <<= 1;
+      left -= count[length];
+      if (left < 0) {
+        return left;
+      }
+    }
+
+    short offsets[MAX_BITS + 1];
+    offsets[1] = 0;
+    for (int length = 1; length < MAX_BITS; ++length) {
+      offsets[length + 1] = offsets[length] + count[length];
+    }
+    for (int i = 0; i < symbolCount; ++i) {
+      if (lengths[i] != 0) {
+        symbol[offsets[lengths[i]]++] = static_cast<short>(i);
+      }
+    }
+    return left;
+  }
+};
+
+
+class Inflater {
+public:
+
+  Inflater(const char *data, size_t size, size_t expectedSize, QByteArray &output)
+    : m_Input(reinterpret_cast<const uchar*>(data)), m_InputSize(size), m_ExpectedSize(expectedSize)
+    , m_Output(output)
+  {
+  }
+
+  bool run()
+  {
+    m_Output.clear();
+    m_Output.reserve(static_cast<int>(m_ExpectedSize));
+    bool last = false;
+    while (!last && !m_Error) {
+      last = bits(1) != 0;
+      switch (bits(2)) {
+        case 0: stored(); break;
+        case 1: fixed(); break;
+        case 2: dynamic(); break;
+        default: m_Error = true; break;
+      }
+    }
+    return !m_Error && (static_cast<size_t>(m_Output.size()) == m_ExpectedSize);
+  }
+
+private:
+
+  int bits(int need)
+  {
+    quint32 value = m_BitBuffer;
+    while (m_BitCount < need) {
+      if (m_InputPos == m_InputSize) {
+        m_Error = true;
+        return 0;
+      }
+      value |= static_cast<quint32>(m_Input[m_InputPos++]) << m_BitCount;
+      m_BitCount += 8;
+    }
+    m_BitBuffer = value >> need;
+    m_BitCount -= need;
+    return static_cast<int>(value & ((1u << need) - 1));
+  }
+
+  int decode(const Huffman &huffman)
+  {
+    // codes are stored most significant bit first, unlike everything else
+    int code = 0;
+    int first = 0;
+    int index = 0;
+    for (int length = 1; length <= MAX_BITS; ++length) {
+      code |= bits(1);
+      if (m_Error) {
+        return -1;
+      }
+      int count = huffman.count[length];
+      if (code - count < first) {
+        return huffman.symbol[index + (code - first)];
+      }
+      index += count;
+      first += count;
+      first <<= 1;
+      code <<= 1;
+    }
+    m_Error = true;
+    return -1;
+  }
+
+  bool put(char byte)
+  {
+    if (static_cast<size_t>(m_Output.size()) >= m_ExpectedSize) {
+      m_Error = true;
+      return false;
+    }
+    m_Output.append(byte);
+    return true;
+  }
+
+  void stored()
+  {
+    // stored blocks start at a byte boundary
+    m_BitBuffer = 0;
+    m_BitCount = 0;
+    if (m_InputSize - m_InputPos < 4) {
+      m_Error = true;
+      return;
+    }
+    unsigned int length = m_Input[m_InputPos] | (m_Input[m_InputPos + 1] << 8);
+    unsigned int complement = m_Input[m_InputPos + 2] | (m_Input[m_InputPos + 3] << 8);
+    m_InputPos += 4;
+    if ((length != (~complement & 0xFFFF)) || (m_InputSize - m_InputPos < length)
+        || (m_ExpectedSize - m_Output.size() < length)) {
+      m_Error = true;
+      return;
+    }
+    m_Output.append(reinterpret_cast<const char*>(m_Input + m_InputPos), static_cast<int>(length));
+    m_InputPos += length;
+  }
+
+  void codes(const Huffman &lengthCode, const Huffman &distanceCode)
+  {
+    for (;;) {
+      int symbol = decode(lengthCode);
+      if (m_Error) {
+        return;
+      }
+      if (symbol < 256) {
+        if (!put(static_cast<char>(symbol))) {
+          return;
+        }
+      } else if (symbol == 256) {
+        return;
+      } else {
+        symbol -= 257;
+        if (symbol >= 29) {
+          m_Error = true;
+          return;
+        }
+        int length = LENGTH_BASE[symbol] + bits(LENGTH_EXTRA[symbol]);
+        symbol = decode(distanceCode);
+        if (m_Error || (symbol >= MAX_DISTANCE_CODES)) {
+          m_Error = true;
+          return;
+        }
+        int distance = DISTANCE_BASE[symbol] + bits(DISTANCE_EXTRA[symbol]);
+        if (m_Error || (distance > m_Output.size())) {
+          m_Error = true;
+          return;
+        }
+        // the source may overlap the bytes being written, copy one at a time
+        for (int i = 0; i < length; ++i) {
+          if (!put(m_Output.at(m_Output.size() - distance))) {
+            return;
+          }
+        }
+      }
+    }
+  }
+
+  void fixed()
+  {
+    static const struct FixedCodes {
+      Huffman lengthCode;
+      Huffman distanceCode;
+      FixedCodes() {
+        short lengths[FIXED_LENGTH_CODES];
+        int symbol = 0;
+        for (; symbol < 144; ++symbol) lengths[symbol] = 8;
+        for (; symbol < 256; ++symbol) lengths[symbol] = 9;
+        for (; symbol < 280; ++symbol) lengths[symbol] = 7;
+        for (; symbol < FIXED_LENGTH_CODES; ++symbol) lengths[symbol] = 8;
+        lengthCode.construct(lengths, FIXED_LENGTH_CODES);
+        for (symbol = 0; symbol < MAX_DISTANCE_CODES; ++symbol) lengths[symbol] = 5;
+        distanceCode.construct(lengths, MAX_DISTANCE_CODES);
+      }
+    } fixedCodes;
+    codes(fixedCodes.lengthCode, fixedCodes.distanceCode);
+  }
+
+  void dynamic()
+  {
+    static const short order[19] = { 16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15 };
+
+    int lengthCount = bits(5) + 257;
+    int distanceCount = bits(5) + 1;
+    int codeCount = bits(4) + 4;
+    if (m_Error || (lengthCount > MAX_LENGTH_CODES) || (distanceCount > MAX_DISTANCE_CODES)) {
+      m_Error = true;
+      return;
+    }
+
+    short lengths[MAX_LENGTH_CODES + MAX_DISTANCE_CODES];
+    int index = 0;
+    for (; index < codeCount; ++index) {
+      lengths[order[index]] = static_cast<short>(bits(3));
+    }
+    for (; index < 19; ++index) {
+      lengths[order[index]] = 0;
+    }
+
+    // the code lengths of the actual codes are themselves huffman coded
+    Huffman lengthCode;
+    Huffman distanceCode;
+    if (m_Error || (lengthCode.construct(lengths, 19) != 0)) {
+      m_Error = true;
+      return;
+    }
+
+    index = 0;
+    while (index < lengthCount + distanceCount) {
+      int symbol = decode(lengthCode);
+      if (m_Error) {
+        return;
+      }
+      if (symbol < 16) {
+        lengths[index++] = static_cast<short>(symbol);
+        continue;
+      }
+      short length = 0;
+      int repeat = 0;
+      if (symbol == 16) {
+        if (index == 0) {
+          m_Error = true;
+          return;
+        }
+        length = lengths[index - 1];
+        repeat = 3 + bits(2);
+      } else if (symbol == 17) {
+        repeat = 3 + bits(3);
+      } else {
+        repeat = 11 + bits(7);
+      }
+      if (m_Error || (index + repeat > lengthCount + distanceCount)) {
+        m_Error = true;
+        return;
+      }
+      while (repeat-- > 0) {
+        lengths[index++] = length;
+      }
+    }
+
+    if (lengths[256] == 0) {
+      // no end of block code
+      m_Error = true;
+      return;
+    }
+
+    // incomplete codes are only allowed for a single code
+    int left = lengthCode.construct(lengths, lengthCount);
+    if ((left < 0) || ((left > 0) && (lengthCount - lengthCode.count[0] != 1))) {
+      m_Error = true;
+      return;
+    }
+    left = distanceCode.construct(lengths + lengthCount, distanceCount);
+    if ((left < 0) || ((left > 0) && (distanceCount - distanceCode.count[0] != 1))) {
+      m_Error = true;
+      return;
+    }
+
+    codes(lengthCode, distanceCode);
+  }
+
+private:
+
+  const uchar *m_Input;
+  size_t m_InputSize;
+  size_t m_InputPos { 0 };
+  quint32 m_BitBuffer { 0 };
+  int m_BitCount { 0 };
+  size_t m_ExpectedSize;
+  QByteArray &m_Output;
+  bool m_Error { false };
+
+};
+
+} // namespace
+
+
+bool inflateRaw(const char *data, size_t size, size_t expectedSize, QByteArray &output)
+{
+  return Inflater(data, size, expectedSize, output).run();
+}
+
+
+quint32 crc32(const QByteArray &data)
+{
+  static const struct Table {
+    quint32 values[256];
+    Table() {
+      for (quint32 i = 0; i < 256; ++i) {
+        quint32 value = i;
+        for (int bit = 0; bit < 8; ++bit) {
+          value = (value & 1) ? (0xEDB88320 ^ (value >> 1)) : (value >> 1);
+        }
+        values[i] = value;
+      }
+    }
+  } table;
+
+  quint32 crc = 0xFFFFFFFF;
+  const uchar *pos = reinterpret_cast<const uchar*>(data.constData());
+  for (int i = 0; i < data.size(); ++i) {
+    crc = table.values[(crc ^ pos[i]) & 0xFF] ^ (crc >> 8);
+  }
+  return crc ^ 0xFFFFFFFF;
+}
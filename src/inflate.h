@@ -0,0 +1,42 @@
+/*
+Copyright (C) 2012 Sebastian Herbord. All rights reserved.
+
+This file is part of NMM Import plugin for MO
+
+NMM Import plugin is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+NMM Import plugin is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with NMM Import plugin.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef INFLATE_H
+#define INFLATE_H
+
+#include <QByteArray>
+
+
+/**
+ * @brief decompress a raw deflate stream (rfc 1951) as stored in zip files
+ * @param data the compressed data
+ * @param size size of the compressed data in bytes
+ * @param expectedSize size of the decompressed data. Streams that decompress to anything
+ *                     else are rejected
+ * @param output receives the decompressed data
+ * @return false if the stream is invalid or its size doesn't match
+ */
+bool inflateRaw(const char *data, size_t size, size_t expectedSize, QByteArray &output);
+
+/**
+ * @return crc-32 checksum of the data as used in zip files
+ */
+quint32 crc32(const QByteArray &data);
+
+#endif // INFLATE_H
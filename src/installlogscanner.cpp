@@ -0,0 +1,699 @@
+/*
+Copyright (C) 2012 Sebastian Herbord. All rights reserved.
+
+This file is part of NMM Import plugin for MO
+
+NMM Import plugin is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+NMM Import plugin is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with NMM Import plugin.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "installlogscanner.h"
+
+#include <QByteArray>
+#include <QHash>
+#include <algorithm>
+#include <cstring>
+#include <limits>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#define NMMIMPORT_SSE2
+#include <emmintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
+
+namespace {
+
+typedef InstallLogScanner::Utf8View Utf8View;
+
+
+#ifdef NMMIMPORT_SSE2
+inline int lowestBit(int mask)
+{
+#ifdef _MSC_VER
+  unsigned long index;
+  _BitScanForward(&index, static_cast<unsigned long>(mask));
+  return static_cast<int>(index);
+#else
+  return __builtin_ctz(static_cast<unsigned int>(mask));
+#endif
+}
+#endif
+
+
+/**
+ * @return the first occurence of ch in [pos, end) or end if there is none
+ */
+const char *findByte(const char *pos, const char *end, char ch)
+{
+#ifdef NMMIMPORT_SSE2
+  // compare 16 bytes per step, the remainder is left to memchr
+  const __m128i needle = _mm_set1_epi8(ch);
+  while (end - pos >= 16) {
+    __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pos));
+    int mask = _mm_movemask_epi8(_mm_cmpeq_epi8(chunk, needle));
+    if (mask != 0) {
+      return pos + lowestBit(mask);
+    }
+    pos += 16;
+  }
+#endif
+  const void *res = memchr(pos, ch, end - pos);
+  return res != nullptr ? static_cast<const char*>(res) : end;
+}
+
+
+inline bool isSpace(char ch)
+{
+  return (ch == ' ') || (ch == '\t') || (ch == '\r') || (ch == '\n');
+}
+
+
+inline bool isNameChar(char ch)
+{
+  return ((ch >= 'a') && (ch <= 'z'))
+      || ((ch >= 'A') && (ch <= 'Z'))
+      || ((ch >= '0') && (ch <= '9'))
+      || (ch == '_') || (ch == '-') || (ch == '.') || (ch == ':');
+}
+
+
+bool isBlank(const char *pos, const char *end)
+{
+  for (; pos < end; ++pos) {
+    if (!isSpace(*pos)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+
+bool hasEntity(const Utf8View &view)
+{
+  return findByte(view.data, view.data + view.size, '&') != view.data + view.size;
+}
+
+
+struct Tag {
+  enum EType {
+    TYPE_OPEN,
+    TYPE_CLOSE,
+    TYPE_EMPTY
+  };
+
+  EType type;
+  Utf8View name;
+  const char *attributes;
+  const char *attributesEnd;
+  const char *end;
+
+  bool is(const char *tagName) const {
+    size_t length = strlen(tagName);
+    return (static_cast<size_t>(name.size) == length) && (memcmp(name.data, tagName, length) == 0);
+  }
+};
+
+
+/**
+ * @brief parse the tag starting at pos, which has to point to a '<'
+ * @return false for malformed tags and for constructs NMM doesn't write (comments,
+ *         cdata sections, processing instructions)
+ */
+bool parseTag(const char *pos, const char *end, Tag &tag)
+{
+  ++pos;
+  tag.type = Tag::TYPE_OPEN;
+  if ((pos < end) && (*pos == '/')) {
+    tag.type = Tag::TYPE_CLOSE;
+    ++pos;
+  }
+
+  const char *nameBegin = pos;
+  while ((pos < end) && isNameChar(*pos)) {
+    ++pos;
+  }
+  if ((pos == nameBegin) || (pos == end)
+      || (!isSpace(*pos) && (*pos != '/') && (*pos != '>'))) {
+    return false;
+  }
+  tag.name = Utf8View(nameBegin, static_cast<int>(pos - nameBegin));
+  tag.attributes = pos;
+
+  // attribute values may contain '>' so quoted strings have to be skipped
+  for (;;) {
+    const char *close = findByte(pos, end, '>');
+    if (close == end) {
+      return false;
+    }
+    const char *quote = pos;
+    while ((quote < close) && (*quote != '"') && (*quote != '\'')) {
+      ++quote;
+    }
+    if (quote == close) {
+      pos = close;
+      break;
+    }
+    const char *quoteEnd = findByte(quote + 1, end, *quote);
+    if (quoteEnd == end) {
+      return false;
+    }
+    pos = quoteEnd + 1;
+  }
+
+  tag.end = pos + 1;
+  tag.attributesEnd = pos;
+  if ((pos > tag.attributes) && (*(pos - 1) == '/')) {
+    if (tag.type == Tag::TYPE_CLOSE) {
+      return false;
+    }
+    tag.type = Tag::TYPE_EMPTY;
+    tag.attributesEnd = pos - 1;
+  }
+
+  return (tag.type != Tag::TYPE_CLOSE) || isBlank(tag.attributes, tag.attributesEnd);
+}
+
+
+/**
+ * @brief advance to the next tag. Only whitespace may be skipped on the way
+ */
+bool nextTag(const char *&pos, const char *end, Tag &tag)
+{
+  const char *open = findByte(pos, end, '<');
+  if ((open == end) || !isBlank(pos, open) || !parseTag(open, end, tag)) {
+    return false;
+  }
+  pos = tag.end;
+  return true;
+}
+
+
+/**
+ * @brief skip the content of an element, including its closing tag
+ * @param contentEnd receives the position of the closing tag
+ */
+bool skipElement(const char *&pos, const char *end, const Tag &open, const char *&contentEnd)
+{
+  if (open.type == Tag::TYPE_EMPTY) {
+    contentEnd = pos;
+    return true;
+  }
+  int depth = 1;
+  Tag tag;
+  while (depth > 0) {
+    const char *next = findByte(pos, end, '<');
+    if ((next == end) || !parseTag(next, end, tag)) {
+      return false;
+    }
+    if (tag.type == Tag::TYPE_OPEN) {
+      ++depth;
+    } else if (tag.type == Tag::TYPE_CLOSE) {
+      --depth;
+    }
+    contentEnd = next;
+    pos = tag.end;
+  }
+  return true;
+}
+
+
+/**
+ * @brief read the text content of an element that has no child elements
+ */
+bool readText(const char *&pos, const char *end, const Tag &open, Utf8View &text)
+{
+  if (open.type == Tag::TYPE_EMPTY) {
+    text = Utf8View();
+    return true;
+  }
+  const char *close = findByte(pos, end, '<');
+  Tag tag;
+  if ((close == end) || !parseTag(close, end, tag)
+      || (tag.type != Tag::TYPE_CLOSE) || (tag.name != open.name)) {
+    return false;
+  }
+  // whitespace-only text isn't reported by the dom parser either
+  text = isBlank(pos, close) ? Utf8View() : Utf8View(pos, static_cast<int>(close - pos));
+  pos = tag.end;
+  return true;
+}
+
+
+bool attribute(const Tag &tag, const char *name, Utf8View &value)
+{
+  const size_t nameLength = strlen(name);
+  const char *pos = tag.attributes;
+  const char *end = tag.attributesEnd;
+  for (;;) {
+    while ((pos < end) && isSpace(*pos)) {
+      ++pos;
+    }
+    if (pos == end) {
+      return false;
+    }
+
+    const char *nameBegin = pos;
+    while ((pos < end) && isNameChar(*pos)) {
+      ++pos;
+    }
+    const char *nameEnd = pos;
+    while ((pos < end) && isSpace(*pos)) {
+      ++pos;
+    }
+    if ((nameBegin == nameEnd) || (pos == end) || (*pos != '=')) {
+      return false;
+    }
+    ++pos;
+    while ((pos < end) && isSpace(*pos)) {
+      ++pos;
+    }
+    if ((pos == end) || ((*pos != '"') && (*pos != '\''))) {
+      return false;
+    }
+    const char *valueEnd = findByte(pos + 1, end, *pos);
+    if (valueEnd == end) {
+      return false;
+    }
+
+    if ((static_cast<size_t>(nameEnd - nameBegin) == nameLength)
+        && (memcmp(nameBegin, name, nameLength) == 0)) {
+      value = Utf8View(pos + 1, static_cast<int>(valueEnd - pos - 1));
+      return true;
+    }
+    pos = valueEnd + 1;
+  }
+}
+
+} // namespace
+
+
+QString InstallLogScanner::Utf8View::toString() const
+{
+  const char *pos = data;
+  const char *end = data + size;
+  const char *amp = findByte(pos, end, '&');
+  if (amp == end) {
+    return QString::fromUtf8(data, size);
+  }
+
+  QString result;
+  while (amp != end) {
+    result.append(QString::fromUtf8(pos, static_cast<int>(amp - pos)));
+    const char *semicolon = findByte(amp, end, ';');
+    QByteArray entity(amp + 1, static_cast<int>(semicolon - amp - 1));
+    bool ok = true;
+    if (entity == "amp") {
+      result.append('&');
+    } else if (entity == "lt") {
+      result.append('<');
+    } else if (entity == "gt") {
+      result.append('>');
+    } else if (entity == "quot") {
+      result.append('"');
+    } else if (entity == "apos") {
+      result.append('\'');
+    } else if (entity.startsWith("#x")) {
+      uint code = entity.mid(2).toUInt(&ok, 16);
+      result.append(QString::fromUcs4(&code, 1));
+    } else if (entity.startsWith('#')) {
+      uint code = entity.mid(1).toUInt(&ok, 10);
+      result.append(QString::fromUcs4(&code, 1));
+    } else {
+      ok = false;
+    }
+    if (!ok || (semicolon == end)) {
+      // not an entity we know, keep it as is
+      result.append(QString::fromUtf8(amp, static_cast<int>(std::min(semicolon + 1, end) - amp)));
+    }
+    pos = std::min(semicolon + 1, end);
+    amp = findByte(pos, end, '&');
+  }
+  result.append(QString::fromUtf8(pos, static_cast<int>(end - pos)));
+  return result;
+}
+
+
+bool InstallLogScanner::Utf8View::operator==(const Utf8View &other) const
+{
+  return (size == other.size) && (memcmp(data, other.data, size) == 0);
+}
+
+
+uint qHash(const InstallLogScanner::Utf8View &view, uint seed)
+{
+  return qHashBits(view.data, view.size, seed);
+}
+
+
+InstallLogScanner::InstallLogScanner(const QString &fileName)
+  : m_File(fileName)
+{
+}
+
+InstallLogScanner::~InstallLogScanner()
+{
+  close();
+}
+
+
+void InstallLogScanner::close()
+{
+  // closing the file also releases the mapping
+  m_File.close();
+  m_Begin = m_End = nullptr;
+  m_ModList = m_DataFiles = Range();
+}
+
+
+bool InstallLogScanner::open()
+{
+  if (!m_File.open(QIODevice::ReadOnly)) {
+    return false;
+  }
+  qint64 size = m_File.size();
+  if ((size <= 0) || (size > std::numeric_limits<int>::max())) {
+    return false;
+  }
+  const uchar *data = m_File.map(0, size);
+  if (data == nullptr) {
+    return false;
+  }
+  m_Begin = reinterpret_cast<const char*>(data);
+  m_End = m_Begin + size;
+
+  const char *pos = m_Begin;
+  if ((m_End - pos >= 3) && (memcmp(pos, "\xEF\xBB\xBF", 3) == 0)) {
+    pos += 3;
+  }
+
+  // anything but utf-8 is left to the generic parser
+  if ((m_End - pos >= 5) && (memcmp(pos, "<?xml", 5) == 0)) {
+    const char *declarationEnd = findByte(pos, m_End, '>');
+    if (declarationEnd == m_End) {
+      return false;
+    }
+    QByteArray declaration = QByteArray(pos, static_cast<int>(declarationEnd - pos)).toLower();
+    if (declaration.contains("encoding") && !declaration.contains("utf-8")) {
+      return false;
+    }
+    pos = declarationEnd + 1;
+  }
+
+  Tag root;
+  if (!nextTag(pos, m_End, root) || !root.is("installLog") || (root.type != Tag::TYPE_OPEN)) {
+    return false;
+  }
+
+  Tag child;
+  for (;;) {
+    if (!nextTag(pos, m_End, child)) {
+      return false;
+    }
+    if (child.type == Tag::TYPE_CLOSE) {
+      return child.is("installLog")
+          && (m_ModList.begin != nullptr)
+          && (m_DataFiles.begin != nullptr);
+    }
+
+    Range *section = nullptr;
+    if (child.is("modList")) {
+      section = &m_ModList;
+    } else if (child.is("dataFiles")) {
+      section = &m_DataFiles;
+    }
+    if ((section != nullptr) && (section->begin != nullptr)) {
+      // the dom parser refuses duplicate sections
+      return false;
+    }
+
+    const char *contentBegin = pos;
+    const char *contentEnd = pos;
+    if (!skipElement(pos, m_End, child, contentEnd)) {
+      return false;
+    }
+    if (section != nullptr) {
+      section->begin = contentBegin;
+      section->end = contentEnd;
+    }
+  }
+}
+
+
+bool InstallLogScanner::readMods(std::vector<ModRecord> &mods) const
+{
+  const char *pos = m_ModList.begin;
+  const char *end = m_ModList.end;
+
+  while (!isBlank(pos, end)) {
+    Tag tag;
+    ModRecord record;
+    if (!nextTag(pos, end, tag) || !tag.is("mod") || (tag.type != Tag::TYPE_OPEN)
+        || !attribute(tag, "key", record.key) || !attribute(tag, "path", record.path)
+        || hasEntity(record.key)) {
+      return false;
+    }
+
+    bool hasName = false;
+    bool hasVersion = false;
+    for (;;) {
+      Tag child;
+      if (!nextTag(pos, end, child)) {
+        return false;
+      }
+      if (child.type == Tag::TYPE_CLOSE) {
+        if (!child.is("mod")) {
+          return false;
+        }
+        break;
+      }
+
+      Utf8View text;
+      if (!readText(pos, end, child, text)) {
+        return false;
+      }
+      if (child.is("name")) {
+        if (hasName) {
+          return false;
+        }
+        record.name = text;
+        hasName = true;
+      } else if (child.is("version")) {
+        if (hasVersion) {
+          return false;
+        }
+        record.version = text;
+        hasVersion = true;
+      }
+    }
+
+    if (!hasName || !hasVersion) {
+      return false;
+    }
+    mods.push_back(record);
+  }
+  return true;
+}
+
+
+std::vector<InstallLogScanner::Range> InstallLogScanner::fileChunks(unsigned int count) const
+{
+  // below this splitting costs more than it saves
+  static const ptrdiff_t MIN_CHUNK_SIZE = 256 * 1024;
+
+  std::vector<Range> result;
+  const char *end = m_DataFiles.end;
+  ptrdiff_t chunkSize = std::max((end - m_DataFiles.begin) / std::max(count, 1u), MIN_CHUNK_SIZE);
+
+  const char *chunkBegin = m_DataFiles.begin;
+  while (chunkBegin < end) {
+    const char *chunkEnd = end;
+    if (end - chunkBegin > chunkSize) {
+      // '<' can't appear unescaped in values so the next "<file" is always an element start
+      for (chunkEnd = findByte(chunkBegin + chunkSize, end, '<'); chunkEnd != end;
+           chunkEnd = findByte(chunkEnd + 1, end, '<')) {
+        if ((end - chunkEnd > 5) && (memcmp(chunkEnd, "<file", 5) == 0)
+            && (isSpace(chunkEnd[5]) || (chunkEnd[5] == '>'))) {
+          break;
+        }
+      }
+    }
+    result.push_back(Range(chunkBegin, chunkEnd));
+    chunkBegin = chunkEnd;
+  }
+  return result;
+}
+
+
+bool InstallLogScanner::readFiles(const Range &chunk, const std::function<void (const FileRecord &)> &callback) const
+{
+  const char *pos = chunk.begin;
+  const char *end = chunk.end;
+
+  FileRecord record;
+  while (!isBlank(pos, end)) {
+    Tag tag;
+    if (!nextTag(pos, end, tag) || !tag.is("file") || (tag.type != Tag::TYPE_OPEN)
+        || !attribute(tag, "path", record.path)) {
+      return false;
+    }
+    record.installingMods.clear();
+
+    Tag mods;
+    if (!nextTag(pos, end, mods) || !mods.is("installingMods") || (mods.type == Tag::TYPE_CLOSE)) {
+      return false;
+    }
+    if (mods.type == Tag::TYPE_OPEN) {
+      for (;;) {
+        Tag mod;
+        if (!nextTag(pos, end, mod)) {
+          return false;
+        }
+        if (mod.type == Tag::TYPE_CLOSE) {
+          if (!mod.is("installingMods")) {
+            return false;
+          }
+          break;
+        }
+
+        Utf8View key;
+        if (!mod.is("mod") || !attribute(mod, "key", key) || hasEntity(key)) {
+          return false;
+        }
+        if (mod.type == Tag::TYPE_OPEN) {
+          Tag close;
+          if (!nextTag(pos, end, close) || (close.type != Tag::TYPE_CLOSE) || !close.is("mod")) {
+            return false;
+          }
+        }
+        record.installingMods.push_back(key);
+      }
+    }
+
+    if (!nextTag(pos, end, tag) || (tag.type != Tag::TYPE_CLOSE) || !tag.is("file")) {
+      return false;
+    }
+    callback(record);
+  }
+  return true;
+}
+
+
+bool InstallLogScanner::writeWithout(QIODevice &output, const QSet<QByteArray> &removedKeys) const
+{
+  // bytes up to this position have been written or deliberately skipped
+  const char *written = m_Begin;
+  auto writeUpTo = [&] (const char *pos) -> bool {
+    bool res = output.write(written, pos - written) == pos - written;
+    written = pos;
+    return res;
+  };
+  auto isRemoved = [&] (const Utf8View &key) -> bool {
+    return removedKeys.contains(QByteArray::fromRawData(key.data, key.size));
+  };
+
+  // elements are removed together with the whitespace preceding them so the
+  // indentation of what is left stays intact
+  auto filterModList = [&] () -> bool {
+    const char *pos = m_ModList.begin;
+    const char *end = m_ModList.end;
+    while (!isBlank(pos, end)) {
+      const char *elementBegin = pos;
+      Tag tag;
+      Utf8View key;
+      const char *contentEnd = nullptr;
+      if (!nextTag(pos, end, tag) || !tag.is("mod") || !attribute(tag, "key", key) || hasEntity(key)
+          || !skipElement(pos, end, tag, contentEnd)) {
+        return false;
+      }
+      if (isRemoved(key)) {
+        if (!writeUpTo(elementBegin)) {
+          return false;
+        }
+        written = pos;
+      }
+    }
+    return true;
+  };
+
+  auto filterDataFiles = [&] () -> bool {
+    const char *pos = m_DataFiles.begin;
+    const char *end = m_DataFiles.end;
+    std::vector<Range> removedMods;
+    while (!isBlank(pos, end)) {
+      const char *elementBegin = pos;
+      Tag tag;
+      Tag mods;
+      if (!nextTag(pos, end, tag) || !tag.is("file") || (tag.type != Tag::TYPE_OPEN)
+          || !nextTag(pos, end, mods) || !mods.is("installingMods") || (mods.type == Tag::TYPE_CLOSE)) {
+        return false;
+      }
+
+      removedMods.clear();
+      int modsLeft = 0;
+      if (mods.type == Tag::TYPE_OPEN) {
+        for (;;) {
+          const char *modBegin = pos;
+          Tag mod;
+          if (!nextTag(pos, end, mod)) {
+            return false;
+          }
+          if (mod.type == Tag::TYPE_CLOSE) {
+            break;
+          }
+          Utf8View key;
+          if (!mod.is("mod") || !attribute(mod, "key", key) || hasEntity(key)) {
+            return false;
+          }
+          if (mod.type == Tag::TYPE_OPEN) {
+            Tag close;
+            if (!nextTag(pos, end, close) || (close.type != Tag::TYPE_CLOSE)) {
+              return false;
+            }
+          }
+          if (isRemoved(key)) {
+            removedMods.push_back(Range(modBegin, pos));
+          } else {
+            ++modsLeft;
+          }
+        }
+      }
+
+      if (!nextTag(pos, end, tag) || (tag.type != Tag::TYPE_CLOSE) || !tag.is("file")) {
+        return false;
+      }
+
+      if ((modsLeft == 0) && !removedKeys.isEmpty()) {
+        if (!writeUpTo(elementBegin)) {
+          return false;
+        }
+        written = pos;
+      } else {
+        for (auto iter = removedMods.begin(); iter != removedMods.end(); ++iter) {
+          if (!writeUpTo(iter->begin)) {
+            return false;
+          }
+          written = iter->end;
+        }
+      }
+    }
+    return true;
+  };
+
+  // the sections are written in whatever order they appear in the file
+  bool res = (m_ModList.begin < m_DataFiles.begin) ? (filterModList() && filterDataFiles())
+                                                   : (filterDataFiles() && filterModList());
+  return res && writeUpTo(m_End);
+}
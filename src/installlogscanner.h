@@ -0,0 +1,154 @@
+/*
+Copyright (C) 2012 Sebastian Herbord. All rights reserved.
+
+This file is part of NMM Import plugin for MO
+
+NMM Import plugin is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+NMM Import plugin is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with NMM Import plugin.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef INSTALLLOGSCANNER_H
+#define INSTALLLOGSCANNER_H
+
+#include <QByteArray>
+#include <QFile>
+#include <QIODevice>
+#include <QSet>
+#include <QString>
+#include <functional>
+#include <vector>
+
+
+/**
+ * @brief fast path parser for the InstallLog.xml written by NMM
+ *
+ * The file is memory mapped and scanned for the handful of constructs NMM actually
+ * writes. Values are handed out as views into the mapping and only decoded when the
+ * caller asks for them. Anything the scanner doesn't expect (comments, CDATA, unknown
+ * nesting, non-utf8 encodings, ...) makes it fail, in which case the caller is expected
+ * to fall back to the generic DOM parser.
+ */
+class InstallLogScanner
+{
+public:
+
+  /**
+   * @brief non-owning reference to utf-8 encoded text inside the mapped file
+   */
+  struct Utf8View {
+    const char *data;
+    int size;
+
+    Utf8View() : data(nullptr), size(0) {}
+    Utf8View(const char *data, int size) : data(data), size(size) {}
+
+    bool isEmpty() const { return size == 0; }
+
+    /**
+     * @return the decoded text with xml entities resolved
+     */
+    QString toString() const;
+
+    bool operator==(const Utf8View &other) const;
+    bool operator!=(const Utf8View &other) const { return !(*this == other); }
+  };
+
+  struct ModRecord {
+    Utf8View key;
+    Utf8View path;
+    Utf8View name;
+    Utf8View version;
+  };
+
+  struct FileRecord {
+    Utf8View path;
+    std::vector<Utf8View> installingMods;
+  };
+
+  /**
+   * @brief a byte range of the mapped file
+   */
+  struct Range {
+    const char *begin;
+    const char *end;
+    Range() : begin(nullptr), end(nullptr) {}
+    Range(const char *begin, const char *end) : begin(begin), end(end) {}
+  };
+
+public:
+
+  explicit InstallLogScanner(const QString &fileName);
+  ~InstallLogScanner();
+
+  /**
+   * @brief map the file and locate the modList and dataFiles sections
+   * @return false if the file can't be mapped or isn't structured as expected
+   */
+  bool open();
+
+  /**
+   * @brief read the entries of the modList section in document order
+   * @param mods receives the mods
+   * @return false if the section contains unexpected constructs
+   */
+  bool readMods(std::vector<ModRecord> &mods) const;
+
+  /**
+   * @brief split the dataFiles section at file element boundaries
+   * @param count number of chunks to produce. Small sections produce fewer chunks
+   * @return the chunks in document order, each can be read independently through readFiles
+   */
+  std::vector<Range> fileChunks(unsigned int count) const;
+
+  /**
+   * @brief visit the entries of one chunk of the dataFiles section in document order
+   * @param chunk a chunk as returned by fileChunks
+   * @param callback called for each file. The installing mods are listed in the order
+   *                 NMM wrote them, the record is only valid for the duration of the call
+   * @return false if the chunk contains unexpected constructs
+   * @note may be called concurrently for different chunks
+   */
+  bool readFiles(const Range &chunk, const std::function<void (const FileRecord &)> &callback) const;
+
+  /**
+   * @brief write the log without the specified mods
+   *
+   * The modList entries of the mods are dropped, as are their entries in the installingMods
+   * of each file. Files no mod is left installing are dropped completely. Everything else is
+   * copied byte for byte.
+   * @param output device to write to
+   * @param removedKeys keys of the mods to remove
+   * @return false if writing failed or the file contains unexpected constructs, including
+   *         keys with xml entities, which are compared as raw bytes
+   */
+  bool writeWithout(QIODevice &output, const QSet<QByteArray> &removedKeys) const;
+
+  /**
+   * @brief release the mapping and close the file
+   */
+  void close();
+
+private:
+
+  QFile m_File;
+  const char *m_Begin { nullptr };
+  const char *m_End { nullptr };
+
+  Range m_ModList;
+  Range m_DataFiles;
+
+};
+
+uint qHash(const InstallLogScanner::Utf8View &view, uint seed = 0);
+
+#endif // INSTALLLOGSCANNER_H
@@ -0,0 +1,269 @@
+/*
+Copyright (C) 2012 Sebastian Herbord. All rights reserved.
+
+This file is part of NMM Import plugin for MO
+
+NMM Import plugin is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+NMM Import plugin is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with NMM Import plugin.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "installlogsnapshot.h"
+
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QFile>
+#include <QFileInfo>
+#include <QHash>
+#include <QSaveFile>
+#include <QtEndian>
+#include <cstring>
+
+
+namespace {
+
+// layout, all integers little endian:
+//   header   magic, version, mod count, path count, file count, pool size (in characters),
+//            log size, log modification time (msecs since epoch), log md5
+//   mods     key, name, version and install file as (offset, length) into the pool,
+//            index of the first file and number of files
+//   paths    distinct file paths as (offset, length) into the pool and their hash
+//   files    path index per file of each mod, the top bit set for the primary mod
+//   pool     utf-16 text of all strings
+const char MAGIC[8] = { 'N', 'M', 'M', 'L', 'O', 'G', 'S', 'N' };
+const quint32 VERSION = 1;
+
+const qint64 HEADER_SIZE = 64;
+const qint64 MOD_SIZE = 40;
+const qint64 PATH_SIZE = 12;
+const qint64 FILE_SIZE = 4;
+
+const quint32 PRIMARY_FLAG = 0x80000000u;
+
+// the pool is written and mapped as native utf-16
+Q_STATIC_ASSERT(Q_BYTE_ORDER == Q_LITTLE_ENDIAN);
+
+template <typename T> void append(QByteArray &buffer, T value)
+{
+  value = qToLittleEndian(value);
+  buffer.append(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+template <typename T> T load(const uchar *data)
+{
+  return qFromLittleEndian<T>(data);
+}
+
+} // namespace
+
+
+InstallLogSnapshot::InstallLogSnapshot(const QString &snapshotFile, const QString &installLog)
+  : m_SnapshotFile(snapshotFile), m_InstallLog(installLog)
+{
+  QFileInfo logInfo(installLog);
+  m_LogSize = logInfo.size();
+  m_LogTime = logInfo.lastModified().toMSecsSinceEpoch();
+}
+
+const QByteArray &InstallLogSnapshot::logHash()
+{
+  if (m_LogHash.isEmpty()) {
+    QFile log(m_InstallLog);
+    QCryptographicHash hash(QCryptographicHash::Md5);
+    if (log.open(QIODevice::ReadOnly) && hash.addData(&log)) {
+      m_LogHash = hash.result();
+    }
+  }
+  return m_LogHash;
+}
+
+bool InstallLogSnapshot::matchesLog(const uchar *header)
+{
+  if ((memcmp(header, MAGIC, sizeof(MAGIC)) != 0) || (load<quint32>(header + 8) != VERSION)) {
+    qDebug("InstallLog snapshot was written by a different version");
+    return false;
+  }
+
+  // size and time first, hashing means reading the whole log
+  if ((load<qint64>(header + 32) != m_LogSize) || (load<qint64>(header + 40) != m_LogTime)
+      || (QByteArray::fromRawData(reinterpret_cast<const char*>(header + 48), 16) != logHash())) {
+    qDebug("InstallLog.xml changed since the snapshot was taken");
+    return false;
+  }
+  return true;
+}
+
+bool InstallLogSnapshot::isCurrent()
+{
+  QFile file(m_SnapshotFile);
+  if (!file.open(QIODevice::ReadOnly)) {
+    return false;
+  }
+  QByteArray header = file.read(HEADER_SIZE);
+  return (header.size() == HEADER_SIZE) && matchesLog(reinterpret_cast<const uchar*>(header.constData()));
+}
+
+bool InstallLogSnapshot::read(ModList &modList)
+{
+  QFile file(m_SnapshotFile);
+  if (!file.open(QIODevice::ReadOnly) || (file.size() < HEADER_SIZE)) {
+    return false;
+  }
+  const uchar *data = file.map(0, file.size());
+  if (data == nullptr) {
+    return false;
+  }
+
+  if (!matchesLog(data)) {
+    return false;
+  }
+
+  quint32 modCount = load<quint32>(data + 12);
+  quint32 pathCount = load<quint32>(data + 16);
+  quint32 fileCount = load<quint32>(data + 20);
+  quint64 poolSize = load<quint64>(data + 24);
+
+  qint64 poolOffset = HEADER_SIZE + modCount * MOD_SIZE + pathCount * PATH_SIZE + fileCount * FILE_SIZE;
+  if ((poolSize > static_cast<quint64>(file.size()))
+      || (poolOffset + static_cast<qint64>(poolSize * sizeof(QChar)) != file.size())) {
+    qWarning("InstallLog snapshot is damaged");
+    return false;
+  }
+  const uchar *modData = data + HEADER_SIZE;
+  const uchar *pathData = modData + modCount * MOD_SIZE;
+  const uchar *fileData = pathData + pathCount * PATH_SIZE;
+  const QChar *pool = reinterpret_cast<const QChar*>(data + poolOffset);
+
+  auto readString = [pool, poolSize] (const uchar *reference, QString &result) -> bool {
+    quint32 offset = load<quint32>(reference);
+    quint32 length = load<quint32>(reference + 4);
+    if (static_cast<quint64>(offset) + length > poolSize) {
+      return false;
+    }
+    result = QString(pool + offset, length);
+    return true;
+  };
+
+  std::vector<NormalizedPath> paths(pathCount);
+  bool valid = true;
+  for (quint32 i = 0; (i < pathCount) && valid; ++i) {
+    const uchar *reference = pathData + i * PATH_SIZE;
+    QString path;
+    valid = readString(reference, path);
+    paths[i] = NormalizedPath(path, load<quint32>(reference + 8));
+  }
+
+  modList.clear();
+  modList.reserve(modCount);
+  for (quint32 i = 0; (i < modCount) && valid; ++i) {
+    const uchar *reference = modData + i * MOD_SIZE;
+    modList.push_back(std::make_pair(QString(), NMMImport::ModInfo()));
+    NMMImport::ModInfo &modInfo = modList.back().second;
+    valid = readString(reference, modList.back().first)
+         && readString(reference + 8, modInfo.name)
+         && readString(reference + 16, modInfo.version)
+         && readString(reference + 24, modInfo.installFile);
+
+    quint32 firstFile = load<quint32>(reference + 32);
+    quint32 modFileCount = load<quint32>(reference + 36);
+    if (static_cast<quint64>(firstFile) + modFileCount > fileCount) {
+      valid = false;
+      break;
+    }
+    modInfo.files.reserve(modFileCount);
+    for (quint32 j = firstFile; j < firstFile + modFileCount; ++j) {
+      quint32 entry = load<quint32>(fileData + j * FILE_SIZE);
+      quint32 pathIndex = entry & ~PRIMARY_FLAG;
+      if (pathIndex >= pathCount) {
+        valid = false;
+        break;
+      }
+      modInfo.files.push_back(std::make_pair(paths[pathIndex], (entry & PRIMARY_FLAG) != 0));
+    }
+  }
+
+  if (!valid) {
+    qWarning("InstallLog snapshot is damaged");
+    modList.clear();
+    return false;
+  }
+  return true;
+}
+
+bool InstallLogSnapshot::write(const ModList &modList)
+{
+  if (logHash().isEmpty()) {
+    return false;
+  }
+
+  QString pool;
+  QByteArray mods;
+  QByteArray paths;
+  QByteArray files;
+  QHash<QString, quint32> pathIndices;
+
+  auto appendString = [&pool] (QByteArray &buffer, const QString &string) {
+    append<quint32>(buffer, pool.size());
+    append<quint32>(buffer, string.size());
+    pool.append(string);
+  };
+
+  quint32 fileCount = 0;
+  for (auto iter = modList.begin(); iter != modList.end(); ++iter) {
+    const NMMImport::ModInfo &modInfo = iter->second;
+    appendString(mods, iter->first);
+    appendString(mods, modInfo.name);
+    appendString(mods, modInfo.version);
+    appendString(mods, modInfo.installFile);
+    append<quint32>(mods, fileCount);
+    append<quint32>(mods, static_cast<quint32>(modInfo.files.size()));
+
+    // the same file is usually listed for several mods, store its path only once
+    for (auto fileIter = modInfo.files.begin(); fileIter != modInfo.files.end(); ++fileIter) {
+      const NormalizedPath &path = fileIter->first;
+      auto pathIter = pathIndices.find(path.full());
+      if (pathIter == pathIndices.end()) {
+        pathIter = pathIndices.insert(path.full(), static_cast<quint32>(pathIndices.size()));
+        appendString(paths, path.full());
+        append<quint32>(paths, path.hash());
+      }
+      append<quint32>(files, *pathIter | (fileIter->second ? PRIMARY_FLAG : 0u));
+      ++fileCount;
+    }
+  }
+
+  QByteArray header;
+  header.append(MAGIC, sizeof(MAGIC));
+  append<quint32>(header, VERSION);
+  append<quint32>(header, static_cast<quint32>(modList.size()));
+  append<quint32>(header, static_cast<quint32>(pathIndices.size()));
+  append<quint32>(header, fileCount);
+  append<quint64>(header, pool.size());
+  append<qint64>(header, m_LogSize);
+  append<qint64>(header, m_LogTime);
+  header.append(m_LogHash);
+  Q_ASSERT(header.size() == HEADER_SIZE);
+
+  QSaveFile file(m_SnapshotFile);
+  if (!file.open(QIODevice::WriteOnly)) {
+    qWarning("failed to write InstallLog snapshot %s: %s",
+             qPrintable(m_SnapshotFile), qPrintable(file.errorString()));
+    return false;
+  }
+  file.write(header);
+  file.write(mods);
+  file.write(paths);
+  file.write(files);
+  file.write(reinterpret_cast<const char*>(pool.constData()), pool.size() * sizeof(QChar));
+  return file.commit();
+}
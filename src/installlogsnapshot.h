@@ -0,0 +1,92 @@
+/*
+Copyright (C) 2012 Sebastian Herbord. All rights reserved.
+
+This file is part of NMM Import plugin for MO
+
+NMM Import plugin is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+NMM Import plugin is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with NMM Import plugin.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef INSTALLLOGSNAPSHOT_H
+#define INSTALLLOGSNAPSHOT_H
+
+#include "nmmimport.h"
+
+#include <QByteArray>
+#include <QString>
+#include <utility>
+#include <vector>
+
+
+/**
+ * @brief binary copy of the parsed InstallLog.xml
+ *
+ * Parsing a large log takes a while, even on the fast path. After a successful parse the
+ * mod list is written to a flat file of fixed size records followed by a pool of utf-16
+ * strings, so it can be memory mapped and turned back into the mod list without decoding
+ * any text. The snapshot records size, modification time and md5 of the log it was taken
+ * of and is only used while all three still match.
+ */
+class InstallLogSnapshot
+{
+public:
+
+  typedef std::vector<std::pair<QString, NMMImport::ModInfo>> ModList;
+
+public:
+
+  /**
+   * @param snapshotFile path of the snapshot
+   * @param installLog path of the InstallLog.xml the snapshot belongs to
+   */
+  InstallLogSnapshot(const QString &snapshotFile, const QString &installLog);
+
+  /**
+   * @brief restore the mod list from the snapshot
+   * @param modList receives the mods. The virtual folders are not part of the snapshot
+   * @return false if there is no snapshot, it was written by a different version, is
+   *         damaged or the log changed since
+   */
+  bool read(ModList &modList);
+
+  /**
+   * @return true if read() would find a snapshot of the log as it is now. Only the
+   *         header of the snapshot is read
+   */
+  bool isCurrent();
+
+  /**
+   * @brief replace the snapshot with the specified mod list
+   * @param modList the mods as parsed from the log
+   * @return false if the log can't be read or the snapshot can't be written
+   */
+  bool write(const ModList &modList);
+
+private:
+
+  const QByteArray &logHash();
+  bool matchesLog(const uchar *header);
+
+private:
+
+  QString m_SnapshotFile;
+  QString m_InstallLog;
+
+  qint64 m_LogSize;
+  qint64 m_LogTime;
+  QByteArray m_LogHash;
+
+};
+
+#endif // INSTALLLOGSNAPSHOT_H
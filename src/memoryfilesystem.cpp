@@ -0,0 +1,315 @@
+/*
+Copyright (C) 2012 Sebastian Herbord. All rights reserved.
+
+This file is part of NMM Import plugin for MO
+
+NMM Import plugin is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+NMM Import plugin is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with NMM Import plugin.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "memoryfilesystem.h"
+#include "parallel.h"
+
+#include <QBuffer>
+#include <QDir>
+#include <QMutexLocker>
+#include <chrono>
+#include <thread>
+
+
+MemoryFileSystem::MemoryFileSystem()
+{
+  Node root = { "/", true, QByteArray() };
+  m_Nodes.insert(key("/"), root);
+}
+
+void MemoryFileSystem::setLatency(qint64 operationLatency, qint64 bytesPerSecond)
+{
+  m_OperationLatency = operationLatency;
+  m_BytesPerSecond = bytesPerSecond;
+}
+
+QString MemoryFileSystem::key(const QString &path)
+{
+  return QDir::cleanPath(path).toCaseFolded();
+}
+
+QString MemoryFileSystem::parentKey(const QString &key)
+{
+  int pos = key.lastIndexOf('/');
+  return pos > 0 ? key.left(pos) : QString("/");
+}
+
+void MemoryFileSystem::delay(qint64 bytes) const
+{
+  qint64 microseconds = m_OperationLatency;
+  if (m_BytesPerSecond > 0) {
+    microseconds += bytes * 1000000 / m_BytesPerSecond;
+  }
+  if (microseconds > 0) {
+    std::this_thread::sleep_for(std::chrono::microseconds(microseconds));
+  }
+}
+
+bool MemoryFileSystem::insert(const QString &path, const Node &node)
+{
+  QString nodeKey = key(path);
+  auto parent = m_Nodes.find(parentKey(nodeKey));
+  if ((parent == m_Nodes.end()) || !parent->directory || m_Nodes.contains(nodeKey)) {
+    return false;
+  }
+  m_Nodes.insert(nodeKey, node);
+  m_Children[parentKey(nodeKey)].insert(nodeKey);
+  return true;
+}
+
+void MemoryFileSystem::erase(const QString &nodeKey)
+{
+  m_Nodes.remove(nodeKey);
+  m_Children.remove(nodeKey);
+  auto siblings = m_Children.find(parentKey(nodeKey));
+  if (siblings != m_Children.end()) {
+    siblings->remove(nodeKey);
+  }
+}
+
+void MemoryFileSystem::addFile(const QString &path, const QByteArray &content)
+{
+  QMutexLocker locker(&m_Mutex);
+  QString cleanPath = QDir::cleanPath(path);
+  for (int pos = cleanPath.indexOf('/', 1); pos != -1; pos = cleanPath.indexOf('/', pos + 1)) {
+    Node directory = { cleanPath.left(pos), true, QByteArray() };
+    insert(directory.name, directory);
+  }
+  Node file = { cleanPath, false, content };
+  erase(key(cleanPath));
+  insert(cleanPath, file);
+}
+
+QByteArray MemoryFileSystem::content(const QString &path) const
+{
+  QMutexLocker locker(&m_Mutex);
+  return m_Nodes.value(key(path)).content;
+}
+
+FileSystem::EType MemoryFileSystem::type(const QString &path) const
+{
+  delay();
+  QMutexLocker locker(&m_Mutex);
+  auto iter = m_Nodes.find(key(path));
+  return iter == m_Nodes.end() ? TYPE_NONE : iter->directory ? TYPE_DIRECTORY : TYPE_FILE;
+}
+
+qint64 MemoryFileSystem::fileSize(const QString &path) const
+{
+  delay();
+  QMutexLocker locker(&m_Mutex);
+  auto iter = m_Nodes.find(key(path));
+  return ((iter == m_Nodes.end()) || iter->directory) ? -1 : iter->content.size();
+}
+
+QStringList MemoryFileSystem::entries(const QString &directory) const
+{
+  delay();
+  QMutexLocker locker(&m_Mutex);
+  QStringList result;
+  foreach (const QString &child, m_Children.value(key(directory))) {
+    const QString &name = m_Nodes[child].name;
+    result.append(name.mid(name.lastIndexOf('/') + 1));
+  }
+  return result;
+}
+
+QString MemoryFileSystem::volume(const QString&) const
+{
+  return "/";
+}
+
+qint64 MemoryFileSystem::bytesAvailable(const QString&) const
+{
+  return m_BytesAvailable;
+}
+
+bool MemoryFileSystem::supportsCloning(const QString&, const QString&) const
+{
+  return true;
+}
+
+bool MemoryFileSystem::renameFile(const QString &source, const QString &destination, QString &error)
+{
+  delay();
+  QMutexLocker locker(&m_Mutex);
+  QString sourceKey = key(source);
+  auto iter = m_Nodes.find(sourceKey);
+  if ((iter == m_Nodes.end()) || iter->directory) {
+    error = "no such file";
+    return false;
+  }
+  Node node = *iter;
+  node.name = QDir::cleanPath(destination);
+  if (!insert(destination, node)) {
+    error = "destination exists or its directory is missing";
+    return false;
+  }
+  erase(sourceKey);
+  return true;
+}
+
+bool MemoryFileSystem::copyLocked(const QString &source, const QString &destination, QString &error)
+{
+  auto iter = m_Nodes.find(key(source));
+  if ((iter == m_Nodes.end()) || iter->directory) {
+    error = "no such file";
+    return false;
+  }
+  Node node = *iter;
+  node.name = QDir::cleanPath(destination);
+  if (!insert(destination, node)) {
+    error = "destination exists or its directory is missing";
+    return false;
+  }
+  return true;
+}
+
+bool MemoryFileSystem::copyFile(const QString &source, const QString &destination, QString &error)
+{
+  QMutexLocker locker(&m_Mutex);
+  qint64 size = m_Nodes.value(key(source)).content.size();
+  locker.unlock();
+  delay(size);
+  locker.relock();
+  return copyLocked(source, destination, error);
+}
+
+bool MemoryFileSystem::removeFile(const QString &path, QString &error)
+{
+  delay();
+  QMutexLocker locker(&m_Mutex);
+  QString nodeKey = key(path);
+  auto iter = m_Nodes.find(nodeKey);
+  if ((iter == m_Nodes.end()) || iter->directory) {
+    error = "no such file";
+    return false;
+  }
+  erase(nodeKey);
+  return true;
+}
+
+bool MemoryFileSystem::cloneFile(const QString &source, const QString &destination)
+{
+  // the content is shared until either side is modified, just like a real clone
+  delay();
+  QMutexLocker locker(&m_Mutex);
+  QString error;
+  return copyLocked(source, destination, error);
+}
+
+bool MemoryFileSystem::linkFile(const QString &source, const QString &destination)
+{
+  return cloneFile(source, destination);
+}
+
+bool MemoryFileSystem::renameDirectory(const QString &source, const QString &destination)
+{
+  delay();
+  QMutexLocker locker(&m_Mutex);
+  QString sourceKey = key(source);
+  auto iter = m_Nodes.find(sourceKey);
+  if ((iter == m_Nodes.end()) || !iter->directory) {
+    return false;
+  }
+  QString sourcePath = QDir::cleanPath(source);
+  QString destinationPath = QDir::cleanPath(destination);
+  Node directory = *iter;
+  directory.name = destinationPath;
+  if (!insert(destinationPath, directory)) {
+    return false;
+  }
+
+  // move the content, parents before children
+  QStringList pending(sourceKey);
+  while (!pending.isEmpty()) {
+    QString current = pending.takeFirst();
+    foreach (const QString &child, m_Children.value(current)) {
+      Node node = m_Nodes[child];
+      node.name = destinationPath + node.name.mid(sourcePath.size());
+      insert(node.name, node);
+      pending.append(child);
+    }
+  }
+  // and remove it from the old location, children before parents
+  std::function<void (const QString&)> eraseTree = [&] (const QString &nodeKey) {
+    foreach (const QString &child, m_Children.value(nodeKey)) {
+      eraseTree(child);
+    }
+    erase(nodeKey);
+  };
+  eraseTree(sourceKey);
+  return true;
+}
+
+bool MemoryFileSystem::makeDirectory(const QString &directory)
+{
+  delay();
+  QMutexLocker locker(&m_Mutex);
+  Node node = { QDir::cleanPath(directory), true, QByteArray() };
+  return insert(directory, node);
+}
+
+bool MemoryFileSystem::removeDirectory(const QString &directory)
+{
+  delay();
+  QMutexLocker locker(&m_Mutex);
+  QString nodeKey = key(directory);
+  auto iter = m_Nodes.find(nodeKey);
+  if ((iter == m_Nodes.end()) || !iter->directory || !m_Children.value(nodeKey).isEmpty()) {
+    return false;
+  }
+  erase(nodeKey);
+  return true;
+}
+
+std::vector<QString> MemoryFileSystem::removeFiles(const QStringList &files, unsigned int concurrency)
+{
+  // the simulated latency overlaps like it would on a device serving parallel requests
+  std::vector<QString> errors(files.size());
+  parallelFor(files.size(), concurrency, [&] (size_t index) {
+    removeFile(files.at(static_cast<int>(index)), errors[index]);
+  });
+  return errors;
+}
+
+bool MemoryFileSystem::replaceFile(const QString &path, const std::function<bool (QIODevice&)> &writer)
+{
+  QBuffer buffer;
+  buffer.open(QIODevice::WriteOnly);
+  if (!writer(buffer)) {
+    return false;
+  }
+  delay(buffer.size());
+  QMutexLocker locker(&m_Mutex);
+  QString nodeKey = key(path);
+  auto parent = m_Nodes.find(parentKey(nodeKey));
+  if ((parent == m_Nodes.end()) || !parent->directory) {
+    return false;
+  }
+  erase(nodeKey);
+  Node file = { QDir::cleanPath(path), false, buffer.data() };
+  return insert(path, file);
+}
+
+bool MemoryFileSystem::writeFile(const QString &path, const std::function<bool (QIODevice&)> &writer)
+{
+  // nothing can interrupt a write in memory, both are the same here
+  return replaceFile(path, writer);
+}
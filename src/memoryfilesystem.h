@@ -0,0 +1,119 @@
+/*
+Copyright (C) 2012 Sebastian Herbord. All rights reserved.
+
+This file is part of NMM Import plugin for MO
+
+NMM Import plugin is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+NMM Import plugin is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with NMM Import plugin.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef MEMORYFILESYSTEM_H
+#define MEMORYFILESYSTEM_H
+
+#include "filesystem.h"
+
+#include <QHash>
+#include <QMutex>
+#include <QSet>
+#include <limits>
+
+
+/**
+ * @brief file system held entirely in memory
+ *
+ * Stand-in for the disk to measure the overhead of the import pipeline itself and to
+ * run it deterministically. Paths are case insensitive like on windows and everything
+ * is on a single volume. Each operation can be delayed to simulate storage of a given
+ * speed, the delay is spent outside the lock so concurrent operations overlap like they
+ * would on real storage.
+ */
+class MemoryFileSystem : public FileSystem
+{
+public:
+
+  MemoryFileSystem();
+
+  /**
+   * @brief simulate storage latency and throughput
+   * @param operationLatency microseconds each operation takes
+   * @param bytesPerSecond throughput for operations that copy data, 0 for unlimited
+   */
+  void setLatency(qint64 operationLatency, qint64 bytesPerSecond = 0);
+
+  /**
+   * @brief set the space reported as available
+   */
+  void setBytesAvailable(qint64 bytes) { m_BytesAvailable = bytes; }
+
+  /**
+   * @brief create a file, and all missing parent directories
+   */
+  void addFile(const QString &path, const QByteArray &content);
+
+  /**
+   * @return content of the file, empty if it doesn't exist
+   */
+  QByteArray content(const QString &path) const;
+
+  virtual EType type(const QString &path) const;
+  virtual qint64 fileSize(const QString &path) const;
+  virtual QStringList entries(const QString &directory) const;
+  virtual QString volume(const QString &path) const;
+  virtual qint64 bytesAvailable(const QString &path) const;
+  virtual bool supportsCloning(const QString &source, const QString &destination) const;
+  virtual bool renameFile(const QString &source, const QString &destination, QString &error);
+  virtual bool copyFile(const QString &source, const QString &destination, QString &error);
+  virtual bool removeFile(const QString &path, QString &error);
+  virtual bool cloneFile(const QString &source, const QString &destination);
+  virtual bool linkFile(const QString &source, const QString &destination);
+  virtual bool renameDirectory(const QString &source, const QString &destination);
+  virtual bool makeDirectory(const QString &directory);
+  virtual bool removeDirectory(const QString &directory);
+  virtual std::vector<QString> removeFiles(const QStringList &files, unsigned int concurrency);
+  virtual bool replaceFile(const QString &path, const std::function<bool (QIODevice&)> &writer);
+  virtual bool writeFile(const QString &path, const std::function<bool (QIODevice&)> &writer);
+
+private:
+
+  struct Node {
+    // name as it was created, the key is case-folded
+    QString name;
+    bool directory;
+    QByteArray content;
+  };
+
+private:
+
+  static QString key(const QString &path);
+  static QString parentKey(const QString &key);
+
+  void delay(qint64 bytes = 0) const;
+
+  // these expect the mutex to be locked
+  bool insert(const QString &path, const Node &node);
+  void erase(const QString &key);
+  bool copyLocked(const QString &source, const QString &destination, QString &error);
+
+private:
+
+  mutable QMutex m_Mutex;
+  QHash<QString, Node> m_Nodes;
+  QHash<QString, QSet<QString>> m_Children;
+
+  qint64 m_OperationLatency { 0 };
+  qint64 m_BytesPerSecond { 0 };
+  qint64 m_BytesAvailable { std::numeric_limits<qint64>::max() };
+
+};
+
+#endif // MEMORYFILESYSTEM_H
@@ -0,0 +1,295 @@
+/*
+Copyright (C) 2012 Sebastian Herbord. All rights reserved.
+
+This file is part of NMM Import plugin for MO
+
+NMM Import plugin is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+NMM Import plugin is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with NMM Import plugin.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "memoryprofile.h"
+
+#include <QJsonArray>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+
+#ifdef Q_OS_WIN
+#include <Windows.h>
+#include <Psapi.h>
+#else
+#include <unistd.h>
+#endif
+
+
+namespace {
+
+std::atomic<MemoryProfile*> activeProfile(nullptr);
+
+std::atomic<bool> counting(false);
+std::atomic<qint64> allocationCount(0);
+std::atomic<qint64> allocatedBytes(0);
+
+const std::chrono::milliseconds SAMPLE_INTERVAL(10);
+
+#ifdef NMMIMPORT_COUNT_ALLOCATIONS
+
+void *allocate(std::size_t size)
+{
+  if (counting.load(std::memory_order_relaxed)) {
+    allocationCount.fetch_add(1, std::memory_order_relaxed);
+    allocatedBytes.fetch_add(static_cast<qint64>(size), std::memory_order_relaxed);
+  }
+  return std::malloc(size != 0 ? size : 1);
+}
+
+#endif // NMMIMPORT_COUNT_ALLOCATIONS
+
+} // namespace
+
+
+#ifdef NMMIMPORT_COUNT_ALLOCATIONS
+
+// allocations through operator new go through these so they can be counted. Counting
+// costs a single relaxed load while no profile exists. With the plugin built as a dll
+// this covers the plugin's own allocations, on ELF platforms it replaces the allocator
+// of the whole process, which is why it has to be enabled explicitly
+
+void *operator new(std::size_t size)
+{
+  void *result = allocate(size);
+  if (result == nullptr) {
+    throw std::bad_alloc();
+  }
+  return result;
+}
+
+void *operator new[](std::size_t size)
+{
+  void *result = allocate(size);
+  if (result == nullptr) {
+    throw std::bad_alloc();
+  }
+  return result;
+}
+
+void *operator new(std::size_t size, const std::nothrow_t&) Q_DECL_NOTHROW
+{
+  return allocate(size);
+}
+
+void *operator new[](std::size_t size, const std::nothrow_t&) Q_DECL_NOTHROW
+{
+  return allocate(size);
+}
+
+void operator delete(void *pointer) Q_DECL_NOTHROW
+{
+  std::free(pointer);
+}
+
+void operator delete[](void *pointer) Q_DECL_NOTHROW
+{
+  std::free(pointer);
+}
+
+void operator delete(void *pointer, std::size_t) Q_DECL_NOTHROW
+{
+  std::free(pointer);
+}
+
+void operator delete[](void *pointer, std::size_t) Q_DECL_NOTHROW
+{
+  std::free(pointer);
+}
+
+void operator delete(void *pointer, const std::nothrow_t&) Q_DECL_NOTHROW
+{
+  std::free(pointer);
+}
+
+void operator delete[](void *pointer, const std::nothrow_t&) Q_DECL_NOTHROW
+{
+  std::free(pointer);
+}
+
+#endif // NMMIMPORT_COUNT_ALLOCATIONS
+
+
+MemoryProfile::MemoryProfile()
+{
+  Q_ASSERT(activeProfile == nullptr);
+  m_PeakResident = residentSize();
+  m_Sampler = std::thread([this] { sample(); });
+  counting = true;
+  activeProfile = this;
+}
+
+MemoryProfile::~MemoryProfile()
+{
+  activeProfile = nullptr;
+  counting = false;
+  {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    stopPhase();
+    m_Stop = true;
+  }
+  m_Wakeup.notify_all();
+  m_Sampler.join();
+}
+
+MemoryProfile *MemoryProfile::active()
+{
+  return activeProfile;
+}
+
+void MemoryProfile::beginPhase(const QString &name)
+{
+  MemoryProfile *profile = active();
+  if (profile == nullptr) {
+    return;
+  }
+  std::lock_guard<std::mutex> lock(profile->m_Mutex);
+  profile->stopPhase();
+
+  Phase phase = { name, 0, 0, 0, residentSize(), 0, 0 };
+  profile->m_Phases.push_back(phase);
+  profile->m_PeakResident = phase.startResident;
+  profile->m_PhaseAllocations = allocationCount;
+  profile->m_PhaseAllocatedBytes = allocatedBytes;
+  profile->m_PhaseTimer.start();
+  profile->m_PhaseRunning = true;
+}
+
+void MemoryProfile::endPhase()
+{
+  MemoryProfile *profile = active();
+  if (profile != nullptr) {
+    std::lock_guard<std::mutex> lock(profile->m_Mutex);
+    profile->stopPhase();
+  }
+}
+
+void MemoryProfile::addStructure(const QString &name, qint64 elements, qint64 bytes)
+{
+  MemoryProfile *profile = active();
+  if (profile == nullptr) {
+    return;
+  }
+  std::lock_guard<std::mutex> lock(profile->m_Mutex);
+  auto iter = profile->m_Structures.find(name);
+  if ((iter == profile->m_Structures.end()) || (iter->second.bytes < bytes)) {
+    Structure structure = {
+      profile->m_PhaseRunning ? profile->m_Phases.back().name : QString(), elements, bytes
+    };
+    profile->m_Structures[name] = structure;
+  }
+}
+
+qint64 MemoryProfile::residentSize()
+{
+  // called from the sampler, must not allocate through operator new
+#ifdef Q_OS_WIN
+  PROCESS_MEMORY_COUNTERS counters;
+  if (::GetProcessMemoryInfo(::GetCurrentProcess(), &counters, sizeof(counters))) {
+    return static_cast<qint64>(counters.WorkingSetSize);
+  }
+  return 0;
+#else
+  long pages = 0;
+  std::FILE *statm = std::fopen("/proc/self/statm", "r");
+  if (statm != nullptr) {
+    if (std::fscanf(statm, "%*ld %ld", &pages) != 1) {
+      pages = 0;
+    }
+    std::fclose(statm);
+  }
+  return static_cast<qint64>(pages) * ::sysconf(_SC_PAGESIZE);
+#endif
+}
+
+qint64 MemoryProfile::sizeOf(const QString &string)
+{
+  // header plus the characters and the terminating null
+  return string.capacity() > 0 ? sizeof(QArrayData) + (string.capacity() + 1) * sizeof(QChar) : 0;
+}
+
+qint64 MemoryProfile::sizeOf(const QStringList &list)
+{
+  // QList keeps a pointer per element behind a small header
+  qint64 result = list.isEmpty() ? 0 : 16 + list.size() * sizeof(void*);
+  foreach (const QString &string, list) {
+    result += sizeOf(string);
+  }
+  return result;
+}
+
+QJsonObject MemoryProfile::toJson() const
+{
+  std::lock_guard<std::mutex> lock(m_Mutex);
+
+  QJsonArray phases;
+  for (auto iter = m_Phases.begin(); iter != m_Phases.end(); ++iter) {
+    QJsonObject phase;
+    phase["name"] = iter->name;
+    phase["ms"] = static_cast<double>(iter->milliseconds);
+#ifdef NMMIMPORT_COUNT_ALLOCATIONS
+    phase["allocations"] = static_cast<double>(iter->allocations);
+    phase["allocatedBytes"] = static_cast<double>(iter->allocatedBytes);
+#endif
+    phase["startResidentBytes"] = static_cast<double>(iter->startResident);
+    phase["endResidentBytes"] = static_cast<double>(iter->endResident);
+    phase["peakResidentBytes"] = static_cast<double>(iter->peakResident);
+    phases.append(phase);
+  }
+
+  QJsonObject structures;
+  for (auto iter = m_Structures.begin(); iter != m_Structures.end(); ++iter) {
+    QJsonObject structure;
+    structure["phase"] = iter->second.phase;
+    structure["elements"] = static_cast<double>(iter->second.elements);
+    structure["bytes"] = static_cast<double>(iter->second.bytes);
+    structures[iter->first] = structure;
+  }
+
+  QJsonObject result;
+  result["phases"] = phases;
+  result["structures"] = structures;
+  return result;
+}
+
+void MemoryProfile::stopPhase()
+{
+  if (!m_PhaseRunning) {
+    return;
+  }
+  Phase &phase = m_Phases.back();
+  phase.milliseconds = m_PhaseTimer.elapsed();
+  phase.allocations = allocationCount - m_PhaseAllocations;
+  phase.allocatedBytes = allocatedBytes - m_PhaseAllocatedBytes;
+  phase.endResident = residentSize();
+  phase.peakResident = std::max(m_PeakResident, phase.endResident);
+  m_PhaseRunning = false;
+}
+
+void MemoryProfile::sample()
+{
+  std::unique_lock<std::mutex> lock(m_Mutex);
+  while (!m_Wakeup.wait_for(lock, SAMPLE_INTERVAL, [this] { return m_Stop; })) {
+    m_PeakResident = std::max(m_PeakResident, residentSize());
+  }
+}
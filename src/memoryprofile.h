@@ -0,0 +1,140 @@
+/*
+Copyright (C) 2012 Sebastian Herbord. All rights reserved.
+
+This file is part of NMM Import plugin for MO
+
+NMM Import plugin is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+NMM Import plugin is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with NMM Import plugin.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef MEMORYPROFILE_H
+#define MEMORYPROFILE_H
+
+#include <QElapsedTimer>
+#include <QJsonObject>
+#include <QString>
+#include <QStringList>
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+
+/**
+ * @brief opt-in record of the memory used by each phase of an import
+ *
+ * While a profile exists the resident size of the process is sampled in the background,
+ * so each phase gets its peak resident size. Built with NMMIMPORT_COUNT_ALLOCATIONS
+ * defined, allocations made through operator new by the plugin are counted as well and
+ * each phase also gets its allocation count and allocated bytes. Qt allocates string and
+ * container data inside its own libraries where it can't be counted, the larger data
+ * structures are therefore reported separately with their estimated size.
+ * All static functions do nothing while no profile exists so the calls can stay in place.
+ */
+class MemoryProfile
+{
+public:
+
+  /**
+   * @brief start profiling. There can only be one profile at a time
+   */
+  MemoryProfile();
+  ~MemoryProfile();
+
+  /**
+   * @return the current profile or nullptr if memory isn't being profiled
+   */
+  static MemoryProfile *active();
+
+  /**
+   * @brief end the running phase, if any, and start a new one
+   */
+  static void beginPhase(const QString &name);
+
+  /**
+   * @brief end the running phase
+   */
+  static void endPhase();
+
+  /**
+   * @brief report the size of a data structure, attributed to the running phase
+   * @param name name of the structure. Of several reports with the same name the
+   *             largest is kept
+   * @param elements number of elements in the structure
+   * @param bytes estimated memory used by the structure
+   */
+  static void addStructure(const QString &name, qint64 elements, qint64 bytes);
+
+  /**
+   * @return the current resident size (working set) of the process in bytes
+   */
+  static qint64 residentSize();
+
+  /**
+   * @return estimated heap memory used by the string, 0 for shared empty strings
+   */
+  static qint64 sizeOf(const QString &string);
+
+  /**
+   * @return estimated heap memory used by the list and its strings
+   */
+  static qint64 sizeOf(const QStringList &list);
+
+  /**
+   * @return phases and structures as json
+   */
+  QJsonObject toJson() const;
+
+private:
+
+  struct Phase {
+    QString name;
+    qint64 milliseconds;
+    qint64 allocations;
+    qint64 allocatedBytes;
+    qint64 startResident;
+    qint64 endResident;
+    qint64 peakResident;
+  };
+
+  struct Structure {
+    QString phase;
+    qint64 elements;
+    qint64 bytes;
+  };
+
+private:
+
+  void stopPhase();
+  void sample();
+
+private:
+
+  mutable std::mutex m_Mutex;
+  std::vector<Phase> m_Phases;
+  std::map<QString, Structure> m_Structures;
+  bool m_PhaseRunning { false };
+  QElapsedTimer m_PhaseTimer;
+  qint64 m_PhaseAllocations { 0 };
+  qint64 m_PhaseAllocatedBytes { 0 };
+
+  std::thread m_Sampler;
+  std::condition_variable m_Wakeup;
+  bool m_Stop { false };
+  qint64 m_PeakResident { 0 };
+
+};
+
+#endif // MEMORYPROFILE_H
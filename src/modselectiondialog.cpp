@@ -49,7 +49,7 @@ void ModSelectionDialog::addMod(const QString &key,const QString &name,
   QStringList data;
   data.append(name);
   data.append(version);
-  data.append(QString("%1").arg(fileCount));
+  data.append(fileCount >= 0 ? QString("%1").arg(fileCount) : tr("..."));
 
   QTreeWidgetItem *newItem = new QTreeWidgetItem(data);
   newItem->setFlags(newItem->flags() | Qt::ItemIsUserCheckable);
@@ -59,6 +59,35 @@ void ModSelectionDialog::addMod(const QString &key,const QString &name,
   newItem->setData(0, Qt::UserRole, key);
 
   ui->modsList->addTopLevelItem(newItem);
+  m_Items.insert(key, newItem);
+}
+
+void ModSelectionDialog::setFileCount(const QString &key, int fileCount)
+{
+  QTreeWidgetItem *item = m_Items.value(key);
+  if (item != nullptr) {
+    item->setText(2, QString("%1").arg(fileCount));
+  }
+}
+
+void ModSelectionDialog::setImportedBefore(const QString &key)
+{
+  QTreeWidgetItem *item = m_Items.value(key);
+  if ((item == nullptr) || m_ChangedByUser.contains(key)) {
+    return;
+  }
+  m_Updating = true;
+  item->setCheckState(0, Qt::Unchecked);
+  item->setToolTip(0, tr("This mod was imported before and hasn't changed since"));
+  m_Updating = false;
+}
+
+void ModSelectionDialog::setLoading(bool loading)
+{
+  m_Loading = loading;
+  if (!loading && m_AcceptPending) {
+    accept();
+  }
 }
 
 std::vector<QString> ModSelectionDialog::getEnabledMods() const
@@ -76,7 +105,17 @@ std::vector<QString> ModSelectionDialog::getEnabledMods() const
 
 void ModSelectionDialog::on_continueButton_clicked()
 {
-  accept();
+  if (m_Loading) {
+    // the selection is final, the dialog closes as soon as the file lists are read
+    m_AcceptPending = true;
+    ui->continueButton->setEnabled(false);
+    ui->continueButton->setText(tr("Reading files..."));
+    ui->modsList->setEnabled(false);
+    ui->selectAllButton->setEnabled(false);
+    ui->deselectAllButton->setEnabled(false);
+  } else {
+    accept();
+  }
 }
 
 
@@ -98,3 +137,10 @@ void ModSelectionDialog::on_deselectAllButton_clicked()
     ui->modsList->topLevelItem(i)->setCheckState(0, Qt::Unchecked);
   }
 }
+
+void ModSelectionDialog::on_modsList_itemChanged(QTreeWidgetItem *item, int column)
+{
+  if ((column == 0) && !m_Updating) {
+    m_ChangedByUser.insert(item->data(0, Qt::UserRole).toString());
+  }
+}
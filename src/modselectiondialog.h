@@ -21,9 +21,13 @@ along with NMM Import plugin.  If not, see <http://www.gnu.org/licenses/>.
 #define MODSELECTIONDIALOG_H
 
 #include <QDialog>
+#include <QHash>
+#include <QSet>
 #include <vector>
 #include <set>
 
+class QTreeWidgetItem;
+
 namespace Ui {
 class ModSelectionDialog;
 }
@@ -41,10 +45,26 @@ public:
    * @param key key of the mod
    * @param name name of the mod (displayed)
    * @param version version of the mod
-   * @param fileCount number of files belonging to the mod
+   * @param fileCount number of files belonging to the mod, -1 if not known yet
+   */
+  void addMod(const QString &key, const QString &name, const QString &version, int fileCount);
+
+  /**
+   * @brief update the number of files displayed for a mod
    */
-  void addMod(const QString &key, const QString &name, const QString &version,
-              int fileCount);
+  void setFileCount(const QString &key, int fileCount);
+
+  /**
+   * @brief mark a mod as imported before once that is known. It is deselected unless
+   *        the user already changed its selection
+   */
+  void setImportedBefore(const QString &key);
+
+  /**
+   * @brief while loading the file lists are still being read. Continue can be clicked
+   *        but only closes the dialog once loading is done
+   */
+  void setLoading(bool loading);
 
   /**
    * @brief retrieve a set of enabled mods
@@ -61,8 +81,15 @@ private slots:
 
   void on_deselectAllButton_clicked();
 
+  void on_modsList_itemChanged(QTreeWidgetItem *item, int column);
+
 private:
   Ui::ModSelectionDialog *ui;
+  QHash<QString, QTreeWidgetItem*> m_Items;
+  QSet<QString> m_ChangedByUser;
+  bool m_Updating { false };
+  bool m_Loading { false };
+  bool m_AcceptPending { false };
 };
 
 #endif // MODSELECTIONDIALOG_H
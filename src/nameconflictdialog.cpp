@@ -0,0 +1,110 @@
+/*
+Copyright (C) 2012 Sebastian Herbord. All rights reserved.
+
+This file is part of NMM Import plugin for MO
+
+NMM Import plugin is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+NMM Import plugin is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with NMM Import plugin.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "nameconflictdialog.h"
+#include "ui_nameconflictdialog.h"
+
+#include <utility.h>
+
+#include <QMessageBox>
+
+NameConflictDialog::NameConflictDialog(QWidget *parent) :
+  QDialog(parent),
+  ui(new Ui::NameConflictDialog)
+{
+  ui->setupUi(this);
+#if QT_VERSION >= QT_VERSION_CHECK(5,0,0)
+  ui->conflictsList->header()->setSectionResizeMode(0, QHeaderView::Stretch);
+  ui->conflictsList->header()->setSectionResizeMode(1, QHeaderView::Stretch);
+#else
+  ui->conflictsList->header()->setResizeMode(0, QHeaderView::Stretch);
+  ui->conflictsList->header()->setResizeMode(1, QHeaderView::Stretch);
+#endif
+  // only the new name is editable
+  connect(ui->conflictsList, &QTreeWidget::itemDoubleClicked, [this] (QTreeWidgetItem *item, int) {
+    ui->conflictsList->editItem(item, 1);
+  });
+}
+
+NameConflictDialog::~NameConflictDialog()
+{
+  delete ui;
+}
+
+void NameConflictDialog::addConflict(const QString &key, const QString &name,
+                                     const QString &proposedName, bool import)
+{
+  QStringList data;
+  data.append(name);
+  data.append(proposedName);
+
+  QTreeWidgetItem *newItem = new QTreeWidgetItem(data);
+  newItem->setFlags(newItem->flags() | Qt::ItemIsUserCheckable | Qt::ItemIsEditable);
+  newItem->setCheckState(0, import ? Qt::Checked : Qt::Unchecked);
+  newItem->setData(0, Qt::UserRole, key);
+
+  ui->conflictsList->addTopLevelItem(newItem);
+}
+
+std::map<QString, QString> NameConflictDialog::getNames() const
+{
+  std::map<QString, QString> result;
+  for (int i = 0; i < ui->conflictsList->topLevelItemCount(); ++i) {
+    QTreeWidgetItem *item = ui->conflictsList->topLevelItem(i);
+    if (item->checkState(0) == Qt::Checked) {
+      result[item->data(0, Qt::UserRole).toString()] = item->text(1);
+    }
+  }
+  return result;
+}
+
+
+void NameConflictDialog::on_continueButton_clicked()
+{
+  // every name has to be valid and unique, including among the conflicting mods
+  QSet<QString> names = m_TakenNames;
+  QStringList invalid;
+  for (int i = 0; i < ui->conflictsList->topLevelItemCount(); ++i) {
+    QTreeWidgetItem *item = ui->conflictsList->topLevelItem(i);
+    if (item->checkState(0) != Qt::Checked) {
+      continue;
+    }
+    QString name = item->text(1);
+    if (!MOBase::fixDirectoryName(name) || names.contains(name.toCaseFolded())) {
+      invalid.append(item->text(1));
+    } else {
+      item->setText(1, name);
+      names.insert(name.toCaseFolded());
+    }
+  }
+
+  if (!invalid.isEmpty()) {
+    QMessageBox::warning(this, tr("Invalid names"),
+        tr("These names are invalid or already taken, please change them or uncheck the mods:")
+        + "<ul><li>" + invalid.join("</li><li>") + "</li></ul>");
+    return;
+  }
+  accept();
+}
+
+
+void NameConflictDialog::on_cancelButton_clicked()
+{
+  reject();
+}
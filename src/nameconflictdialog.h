@@ -0,0 +1,73 @@
+/*
+Copyright (C) 2012 Sebastian Herbord. All rights reserved.
+
+This file is part of NMM Import plugin for MO
+
+NMM Import plugin is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+NMM Import plugin is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with NMM Import plugin.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef NAMECONFLICTDIALOG_H
+#define NAMECONFLICTDIALOG_H
+
+#include <QDialog>
+#include <QSet>
+#include <QString>
+#include <map>
+
+namespace Ui {
+class NameConflictDialog;
+}
+
+/**
+ * @brief lists all mods whose name is taken so they can be renamed or skipped in one go
+ */
+class NameConflictDialog : public QDialog
+{
+  Q_OBJECT
+
+public:
+  explicit NameConflictDialog(QWidget *parent = 0);
+  ~NameConflictDialog();
+
+  /**
+   * @param names case-folded names that can't be used, those of existing MO mods and of
+   *              the imported mods that aren't in conflict
+   */
+  void setTakenNames(const QSet<QString> &names) { m_TakenNames = names; }
+
+  /**
+   * @brief add a mod to be displayed in the dialog
+   * @param key key of the mod
+   * @param name name of the mod in NMM
+   * @param proposedName name to import the mod as, can be edited by the user
+   * @param import true if the mod should be imported, otherwise it is skipped
+   */
+  void addConflict(const QString &key, const QString &name, const QString &proposedName, bool import);
+
+  /**
+   * @return the names chosen for the mods to import, by key. Skipped mods are not included
+   */
+  std::map<QString, QString> getNames() const;
+
+private slots:
+  void on_cancelButton_clicked();
+
+  void on_continueButton_clicked();
+
+private:
+  Ui::NameConflictDialog *ui;
+  QSet<QString> m_TakenNames;
+};
+
+#endif // NAMECONFLICTDIALOG_H
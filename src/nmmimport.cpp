@@ -22,15 +22,25 @@ along with NMM Import plugin.  If not, see <http://www.gnu.org/licenses/>.
 #include "modselectiondialog.h"
 #include "modedialog.h"
 #include "nmmpathsdialog.h"
+#include "directoryownership.h"
+#include "parallel.h"
+#include "virtualmodconfig.h"
+#include "cacheindex.h"
+#include "backgroundtask.h"
+#include "nameconflictdialog.h"
+#include "installlogsnapshot.h"
+#include "concurrencycontroller.h"
+#include "memoryprofile.h"
 #include <versioninfo.h>
 #include <utility.h>
 #include <report.h>
 #include <imodinterface.h>
 #include <iplugingame.h>
 
-#include <QInputDialog>
 #include <QProgressDialog>
 #include <QMessageBox>
+#include <QTimer>
+#include <mutex>
 #include <regex>
 
 
@@ -66,12 +76,18 @@ NMMImport::NMMImport()
 
 NMMImport::~NMMImport()
 {
+  m_PrefetchCancel.cancel();
+  if (m_Prefetch.joinable()) {
+    m_Prefetch.join();
+  }
   delete m_ArchiveHandler;
 }
 
 bool NMMImport::init(IOrganizer *moInfo)
 {
   m_MOInfo = moInfo;
+  // the game and the plugin settings are only available once MO has finished loading plugins
+  QTimer::singleShot(0, this, [this] () { startPrefetch(); });
   return true;
 }
 
@@ -102,7 +118,35 @@ bool NMMImport::isActive() const
 
 QList<PluginSetting> NMMImport::settings() const
 {
-  return QList<PluginSetting>();
+  return QList<PluginSetting>()
+      << PluginSetting("name_conflicts", tr("What to do with mods whose name is already taken in MO: "
+                                            "\"rename\" or \"skip\". Either can be changed per mod before the import"),
+                       QString("rename"))
+      << PluginSetting("worker_threads", tr("Number of threads used to parse and index, 0 for one per processor"),
+                       0)
+      << PluginSetting("io_queue_depth", tr("Maximum number of file operations running at the same time"),
+                       16)
+      << PluginSetting("adaptive_io", tr("Adjust the number of concurrent file operations to the throughput "
+                                         "measured during the import, up to io_queue_depth"),
+                       true)
+      << PluginSetting("copy_strategy", tr("How files are copied: \"fastest\" renames or clones files where possible, "
+                                           "\"copy\" always copies the data. Moving files is not affected"),
+                       QString("fastest"))
+      << PluginSetting("cache_directory", tr("Directory the snapshot of the parsed InstallLog.xml is kept in. "
+                                             "MO's data directory if empty"),
+                       QString())
+      << PluginSetting("trace_file", tr("File the throughput measurements and concurrency adjustments "
+                                        "are appended to. Nothing is traced if empty"),
+                       QString())
+      // allocations are counted with NMMIMPORT_COUNT_ALLOCATIONS defined: the CMake option of
+      // that name, CONFIG+=count_allocations for qmake or count_allocations=1 for scons
+      << PluginSetting("memory_profile", tr("Record the memory use of each phase in the import report. "
+                                            "Allocations are only counted in builds with the "
+                                            "NMMIMPORT_COUNT_ALLOCATIONS option enabled"),
+                       false)
+      << PluginSetting("prefetch", tr("Locate NMM and read its InstallLog.xml in the background when MO starts, "
+                                      "so the import opens without delay"),
+                       true);
 }
 
 QString NMMImport::displayName() const
@@ -120,131 +164,514 @@ QIcon NMMImport::icon() const
   return QIcon(":/nmmimport/icon_import");
 }
 
+bool NMMImport::ModInfo::operator==(const ModInfo &other) const
+{
+  if ((name != other.name) || (version != other.version) || (installFile != other.installFile)
+      || (files.size() != other.files.size())) {
+    return false;
+  }
+  for (size_t i = 0; i < files.size(); ++i) {
+    if ((files[i].first.full() != other.files[i].first.full())
+        || (files[i].second != other.files[i].second)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+namespace {
+
+// zip entries up to this size are extracted in memory, larger ones are left to the archive
+// library which streams them to disk
+const quint64 MAX_DIRECT_EXTRACT_SIZE = 16 * 1024 * 1024;
+
+}
+
 void updateProgress(float)
 {
-  QCoreApplication::processEvents();
+  // extraction runs on a worker thread, the ui doesn't depend on this
 }
 
 void report7ZipError(QString const &errorMessage)
 {
-  reportError(QObject::tr("extraction error: %1").arg(errorMessage));
+  BackgroundTask::reportError(QObject::tr("extraction error: %1").arg(errorMessage));
 }
 
 
-void NMMImport::unpackFiles(const QString &archiveFile, const QString &outputDirectory,
-                            const std::set<QString> &extractFiles) const
+int NMMImport::unpackFiles(const QString &archiveFile, const QString &outputDirectory,
+                           const std::unordered_set<NormalizedPath> &extractFiles,
+                           const ZipDirectory *directory, const CancellationToken *cancel) const
 {
+  // files left to the archive library
+  const std::unordered_set<NormalizedPath> *archiveFiles = &extractFiles;
+  std::unordered_set<NormalizedPath> remaining;
+  int extracted = 0;
+
+  if (directory != nullptr) {
+    // the directory tells whether there is anything to extract without opening the archive
+    bool found = false;
+    for (auto iter = extractFiles.begin(); (iter != extractFiles.end()) && !found; ++iter) {
+      found = directory->find(*iter) != nullptr;
+    }
+    if (!found) {
+      return 0;
+    }
+
+    // small files in zip archives are extracted directly, without the archive library
+    for (auto iter = extractFiles.begin(); iter != extractFiles.end(); ++iter) {
+      if ((cancel != nullptr) && cancel->isCancelled()) {
+        return extracted;
+      }
+      const ZipDirectory::Entry *entry = directory->find(*iter);
+      if (entry == nullptr) {
+        continue;
+      }
+      if ((entry->size > MAX_DIRECT_EXTRACT_SIZE) || (entry->compressedSize > MAX_DIRECT_EXTRACT_SIZE)) {
+        remaining.insert(*iter);
+        continue;
+      }
+      NormalizedPath outputName = entry->name;
+      outputName.stripPrefix("Data/");
+      QByteArray content;
+      if (directory->extract(*entry, content)
+          && writeFile(outputDirectory + "/" + outputName.relative().toString(), content)) {
+        ++extracted;
+      } else {
+        qDebug("failed to extract %s from %s directly", qPrintable(entry->name.full()), qPrintable(archiveFile));
+        remaining.insert(*iter);
+      }
+    }
+    if (remaining.empty()) {
+      return extracted;
+    }
+    archiveFiles = &remaining;
+  }
+
+  std::lock_guard<std::mutex> lock(m_ArchiveMutex);
+  // the lock may have taken a while, don't start on another archive once cancelled
+  if ((cancel != nullptr) && cancel->isCancelled()) {
+    return extracted;
+  }
   if (!m_ArchiveHandler->open(archiveFile, nullptr)) {
-    reportError(tr("failed to open archive \"%1\": %2").arg(archiveFile).arg(m_ArchiveHandler->getLastError()));
+    BackgroundTask::reportError(tr("failed to open archive \"%1\": %2").arg(archiveFile).arg(m_ArchiveHandler->getLastError()));
+    return 0;
   }
 
   FileData* const *data;
   size_t size;
+  int marked = 0;
   m_ArchiveHandler->getFileList(data, size);
   for (size_t i = 0; i < size; ++i) {
-    QString fileName = data[i]->getFileName().toLower();
-    if (extractFiles.find(fileName) != extractFiles.end()) {
-      if ((fileName.startsWith("Data/", Qt::CaseInsensitive)) ||
-          (fileName.startsWith("Data\\", Qt::CaseInsensitive))) {
-        fileName.remove(0, 5);
-      }
-      data[i]->addOutputFileName(fileName);
+    NormalizedPath fileName(data[i]->getFileName());
+    if (archiveFiles->find(fileName) != archiveFiles->end()) {
+      fileName.stripPrefix("Data/");
+      data[i]->addOutputFileName(fileName.relative().toString());
+      ++marked;
     }
   }
   if (!m_ArchiveHandler->extract(outputDirectory,
                         new FunctionCallback<void, float>(&updateProgress),
                         nullptr,
                         new FunctionCallback<void, QString const &>(&report7ZipError))) {
-    reportError(tr("failed to extract missing files from %1, mod is incomplete: %2").arg(archiveFile).arg(m_ArchiveHandler->getLastError()));
+    BackgroundTask::reportError(tr("failed to extract missing files from %1, mod is incomplete: %2").arg(archiveFile).arg(m_ArchiveHandler->getLastError()));
+    marked = 0;
   }
   m_ArchiveHandler->close();
+  return extracted + marked;
 }
 
 
-IModInterface *NMMImport::initMod(const QString &modName, const ModInfo &info) const
+bool NMMImport::writeFile(const QString &fileName, const QByteArray &content) const
 {
-  static std::tr1::regex exp("([a-zA-Z0-9_\\- ]*?)([-_ ]V?[0-9_]+)?-([1-9][0-9]+).*");
+  // extracted files are recreated from the archive if anything goes wrong, they don't
+  // need the atomic replace and sync
+  return m_FileSystem->makePath(QFileInfo(fileName).absolutePath())
+      && m_FileSystem->writeFile(fileName, [&content] (QIODevice &file) {
+           return file.write(content) == content.size();
+         });
+}
 
-  GuessedValue<QString> temp(modName);
-  IModInterface *mod = m_MOInfo->createMod(temp);
-  if (mod == nullptr) {
-    return nullptr;
+
+QByteArray NMMImport::readInfoXML(const QString &archiveFile, const ZipDirectory *directory) const
+{
+  if (directory != nullptr) {
+    // most caches are zip files, those are read without going through the archive library
+    const ZipDirectory::Entry *entry = directory->find(NormalizedPath("fomod/info.xml"));
+    if (entry == nullptr) {
+      entry = directory->find(NormalizedPath("data/fomod/info.xml"));
+    }
+    QByteArray result;
+    if (entry == nullptr) {
+      return result;
+    } else if (directory->extract(*entry, result)) {
+      return result;
+    }
+    qDebug("failed to read info.xml from %s directly", qPrintable(archiveFile));
+  }
+
+  std::unordered_set<NormalizedPath> extractFiles;
+  extractFiles.insert(NormalizedPath("data/fomod/info.xml"));
+  extractFiles.insert(NormalizedPath("fomod/info.xml"));
+  unpackFiles(archiveFile, QDir::tempPath(), extractFiles, directory);
+
+  QByteArray result;
+  QString xmlPath = QDir::tempPath() + "/fomod/info.xml";
+  QFile infoXML(xmlPath);
+  if (infoXML.open(QIODevice::ReadOnly)) {
+    result = infoXML.readAll();
+    infoXML.remove();
+  } else {
+    qDebug("failed to open: %s", qPrintable(xmlPath));
   }
-  mod->setVersion(VersionInfo(info.version));
+  // this may fail if the directory isn't empty otherwise. That's ok because it
+  // means the directory wasn't empty before
+  QDir().remove(QDir::tempPath() + "/fomod");
+  return result;
+}
+
+
+IModInterface *NMMImport::initMod(const QString &modName) const
+{
+  GuessedValue<QString> temp(modName);
+  return m_MOInfo->createMod(temp);
+}
+
+NMMImport::ModMetadata NMMImport::readMetadata(const ModInfo &info)
+{
+  static std::tr1::regex exp("([a-zA-Z0-9_\\- ]*?)([-_ ]V?[0-9_]+)?-([1-9][0-9]+).*");
+
+  ModMetadata metadata;
+  metadata.version = info.version;
 
   std::tr1::match_results<std::string::const_iterator> result;
   std::string fileName = std::string(info.installFile.toUtf8().constData());
   if (std::tr1::regex_search(fileName, result, exp)) {
     std::string temp = result[3].str();
-    mod->setNexusID(strtol(temp.c_str(), nullptr, 10));
+    metadata.nexusID = strtol(temp.c_str(), nullptr, 10);
   } else {
     qWarning("no nexus id found in %s", qPrintable(info.installFile));
   }
+  return metadata;
+}
+
+bool NMMImport::readInfoMetadata(const QByteArray &infoXML, ModMetadata &metadata)
+{
+  QDomDocument document("fomod");
+  if (!document.setContent(infoXML)) {
+    return false;
+  }
+  QDomElement tlEle = document.documentElement();
 
-  return mod;
+  QString nexusID = getTextNodeValue(tlEle, "Id", true);
+  QString categoryId = getTextNodeValue(tlEle, "CategoryId", true);
+
+  // the id in info.xml is more reliable than the one guessed from the file name
+  if (!nexusID.isEmpty()) {
+    metadata.nexusID = nexusID.toInt();
+  }
+  metadata.hasInfo = true;
+  metadata.newestVersion = getTextNodeValue(tlEle, "LastKnownVersion", true);
+  metadata.endorsed = getTextNodeValue(tlEle, "IsEndorsed", true).compare("true", Qt::CaseInsensitive) == 0;
+  if (!categoryId.isEmpty()) {
+    metadata.category = categoryId.toInt();
+  }
+  return true;
 }
 
-NMMImport::EResult NMMImport::installMod(const ModInfo &modInfo, ModeDialog::InstallMode mode, IModInterface *mod,
-                           const QString &modFolder) const
+void NMMImport::applyMetadata(IModInterface *mod, const ModMetadata &metadata)
 {
-  bool incomplete = false;
+  mod->setVersion(VersionInfo(metadata.version));
+  mod->setNexusID(metadata.nexusID);
+  if (metadata.hasInfo) {
+    mod->setNewestVersion(metadata.newestVersion);
+    mod->setIsEndorsed(metadata.endorsed);
+  }
+  if (metadata.category != -1) {
+    mod->addNexusCategory(metadata.category);
+  }
+}
 
-  QDir dataDir(m_MOInfo->managedGame()->dataDirectory());
-  QString virtualFolder = modFolder + "/VirtualModActivator";
-  QStringList sourceFiles;
-  QStringList destinationFiles;
-  for (auto fileIter = modInfo.files.begin(); fileIter != modInfo.files.end(); ++fileIter) {
-    if (fileIter->second) {
-      QString sourcePath = QDir::fromNativeSeparators(fileIter->first);
-      QString destinationPath;
-
-      if (sourcePath.startsWith(virtualFolder, Qt::CaseInsensitive)) {
-        int index = sourcePath.indexOf('/', virtualFolder.size() + 2);
-        destinationPath = mod->absolutePath() + "/" + sourcePath.mid(index);
-      } else {
-        if (sourcePath.startsWith("Data/", Qt::CaseInsensitive)) {
-          // path relative to skyrim base folder
-          sourcePath.remove(0, 5);
-        } else {
-          qWarning("unrecognized file path: %s", qPrintable(sourcePath));
-          incomplete = true;
-          continue;
-        }
-        destinationPath = mod->absolutePath() + "/" + sourcePath;
-        sourcePath = dataDir.absoluteFilePath(sourcePath);
+QString NMMImport::resolveSource(NormalizedPath &path, const QString &dataPath, const QString &virtualFolder)
+{
+  if (path.stripPrefix(virtualFolder)) {
+    // skip the per-mod directory below the virtual folder
+    path.stripComponent();
+    return path.full();
+  } else if (path.stripPrefix("Data/")) {
+    // path relative to skyrim base folder
+    return QString(dataPath).append(path.relative());
+  } else {
+    return QString();
+  }
+}
+
+void NMMImport::profileModList(const std::vector<std::pair<QString, ModInfo>> &modList)
+{
+  qint64 modBytes = modList.capacity() * sizeof(std::pair<QString, ModInfo>);
+  qint64 fileCount = 0;
+  qint64 fileBytes = 0;
+  // a path installed by several mods shares its string between their lists
+  std::unordered_set<const QChar*> paths;
+  qint64 pathBytes = 0;
+  for (auto iter = modList.begin(); iter != modList.end(); ++iter) {
+    const ModInfo &modInfo = iter->second;
+    modBytes += MemoryProfile::sizeOf(iter->first) + MemoryProfile::sizeOf(modInfo.name)
+              + MemoryProfile::sizeOf(modInfo.version) + MemoryProfile::sizeOf(modInfo.installFile)
+              + MemoryProfile::sizeOf(modInfo.virtualFolder);
+    fileCount += modInfo.files.size();
+    fileBytes += modInfo.files.capacity() * sizeof(std::pair<NormalizedPath, bool>);
+    for (auto fileIter = modInfo.files.begin(); fileIter != modInfo.files.end(); ++fileIter) {
+      if (paths.insert(fileIter->first.full().constData()).second) {
+        pathBytes += MemoryProfile::sizeOf(fileIter->first.full());
       }
+    }
+  }
+  MemoryProfile::addStructure("modList", modList.size(), modBytes);
+  MemoryProfile::addStructure("modList.files", fileCount, fileBytes);
+  MemoryProfile::addStructure("modList.paths", paths.size(), pathBytes);
+}
+
+QString NMMImport::fingerprint(const ModInfo &modInfo)
+{
+  QCryptographicHash hash(QCryptographicHash::Sha1);
+  auto addString = [&hash] (const QString &string) {
+    // the terminating null keeps adjacent strings apart
+    hash.addData(reinterpret_cast<const char*>(string.utf16()), (string.size() + 1) * sizeof(ushort));
+  };
+  addString(modInfo.version);
+  addString(modInfo.installFile);
+  for (auto iter = modInfo.files.begin(); iter != modInfo.files.end(); ++iter) {
+    addString(iter->first.full());
+    hash.addData(iter->second ? "1" : "0", 1);
+  }
+  return QString::fromLatin1(hash.result().toHex());
+}
+
+QSet<QString> NMMImport::existingModNames() const
+{
+  // every mod in MO is a directory in the mods directory, named like the mod
+  QSet<QString> result;
+  foreach (const QString &entry, m_FileSystem->entries(m_MOInfo->modsPath())) {
+    result.insert(entry.toCaseFolded());
+  }
+  return result;
+}
+
+bool NMMImport::resolveModNames(const std::vector<QString> &modKeys, const std::map<QString, ModInfo*> &modsByKey,
+                                const QSet<QString> &existingNames, std::map<QString, QString> &modNames) const
+{
+  bool skip = m_MOInfo->pluginSetting(name(), "name_conflicts").toString() == "skip";
 
-      sourceFiles.append(sourcePath);
-      destinationFiles.append(destinationPath);
+  // mods whose name is free keep it, the conflicting ones can't take those names either
+  QSet<QString> takenNames = existingNames;
+  std::vector<QString> conflicts;
+  for (auto iter = modKeys.begin(); iter != modKeys.end(); ++iter) {
+    auto modIter = modsByKey.find(*iter);
+    if (modIter == modsByKey.end()) {
+      continue;
+    }
+    QString modName = modIter->second->name;
+    if (fixDirectoryName(modName) && !takenNames.contains(modName.toCaseFolded())) {
+      takenNames.insert(modName.toCaseFolded());
+      modNames[*iter] = modName;
     } else {
-      incomplete = true;
+      conflicts.push_back(*iter);
+    }
+  }
+  if (conflicts.empty()) {
+    return true;
+  }
+
+  NameConflictDialog dialog(parentWidget());
+  dialog.setTakenNames(takenNames);
+  QSet<QString> proposedNames = takenNames;
+  for (auto iter = conflicts.begin(); iter != conflicts.end(); ++iter) {
+    const ModInfo &modInfo = *modsByKey.find(*iter)->second;
+    QString baseName = modInfo.name;
+    if (!fixDirectoryName(baseName)) {
+      baseName = QFileInfo(modInfo.installFile).completeBaseName();
+      if (!fixDirectoryName(baseName)) {
+        baseName = tr("NMM Mod");
+      }
+    }
+    QString proposedName = baseName;
+    for (int i = 2; proposedNames.contains(proposedName.toCaseFolded()); ++i) {
+      proposedName = QString("%1 (%2)").arg(baseName).arg(i);
     }
+    proposedNames.insert(proposedName.toCaseFolded());
+    dialog.addConflict(*iter, modInfo.name, proposedName, !skip);
+  }
+  if (dialog.exec() == QDialog::Rejected) {
+    return false;
   }
 
-  bool error = false;
+  std::map<QString, QString> chosenNames = dialog.getNames();
+  modNames.insert(chosenNames.begin(), chosenNames.end());
+  return true;
+}
 
-  if (mode == ModeDialog::MODE_MOVE) {
-    error = !shellMove(sourceFiles, destinationFiles, parentWidget());
-  } else {
-    error = !shellCopy(sourceFiles, destinationFiles, parentWidget());
+bool NMMImport::planTransfer(const std::vector<QString> &modKeys, const std::map<QString, ModInfo*> &modsByKey,
+                             Preflight &preflight, const QString &dataPath, const QString &modFolder,
+                             std::map<QString, TransferPlan> &plans, qint64 &requiredBytes, int &missingFiles,
+                             const CancellationToken &cancel) const
+{
+  QString virtualFolder = NormalizedPath(modFolder + "/VirtualModActivator/").full();
+
+  requiredBytes = 0;
+  missingFiles = 0;
+  for (auto keyIter = modKeys.begin(); keyIter != modKeys.end(); ++keyIter) {
+    auto modIter = modsByKey.find(*keyIter);
+    if (modIter == modsByKey.end()) {
+      continue;
+    }
+    if (cancel.isCancelled()) {
+      return false;
+    }
+    const ModInfo &modInfo = *modIter->second;
+    TransferPlan &plan = plans[*keyIter];
+    if (!modInfo.virtualFolder.isEmpty()) {
+      plan.strategy = preflight.strategy(modInfo.virtualFolder);
+      plan.bytes = m_FileSystem->directorySize(modInfo.virtualFolder, plan.files);
+    } else {
+      plan.strategy = preflight.strategy(dataPath);
+      QStringList sources;
+      sources.reserve(static_cast<int>(modInfo.files.size()));
+      for (auto fileIter = modInfo.files.begin(); fileIter != modInfo.files.end(); ++fileIter) {
+        NormalizedPath path = fileIter->first;
+        sources.append(fileIter->second ? resolveSource(path, dataPath, virtualFolder) : QString());
+      }
+      plan.bytes = preflight.probeFiles(sources, plan.present, &cancel);
+      for (size_t i = 0; i < modInfo.files.size(); ++i) {
+        if (plan.present[i]) {
+          ++plan.files;
+        } else if (modInfo.files[i].second) {
+          ++missingFiles;
+        }
+      }
+    }
+    if (Preflight::needsSpace(plan.strategy)) {
+      requiredBytes += plan.bytes;
+    }
   }
+  return !cancel.isCancelled();
+}
 
-  if (error) {
-    reportError(tr("Problem importing \"%1\", please check if it imported correctly once this "
-                   "process completed: %2").arg(modInfo.name).arg(windowsErrorString(::GetLastError())));
+bool NMMImport::confirmTransfer(const Preflight &preflight, qint64 requiredBytes, int missingFiles) const
+{
+  qint64 availableBytes = preflight.bytesAvailable();
+  if ((availableBytes >= 0) && (requiredBytes > availableBytes)) {
+    QMessageBox::critical(parentWidget(), tr("Not enough space"),
+        tr("The selected mods need %1 MB on \"%2\" but only %3 MB are available. Nothing was imported.")
+        .arg(requiredBytes / (1024 * 1024)).arg(preflight.destinationVolume()).arg(availableBytes / (1024 * 1024)));
+    return false;
   }
 
-  if (!error && (mode == ModeDialog::MODE_COPYDELETE)) {
-    // copy successful, iterate again over all files and remove them
-    for (auto fileIter = modInfo.files.begin(); fileIter != modInfo.files.end() && !error; ++fileIter) {
-      if (fileIter->second) {
-        QString fileName = QDir::fromNativeSeparators(fileIter->first);
-        QString sourcePath = m_MOInfo->managedGame()->gameDirectory().absoluteFilePath(fileName);
-        QFile(sourcePath).remove();
+  if ((missingFiles > 0)
+      && (QMessageBox::question(parentWidget(), tr("Missing files"),
+            tr("%1 file(s) listed in NMMs \"InstallLog.xml\" don't exist anymore. The affected mods can only be "
+               "imported partially. Continue?").arg(missingFiles),
+            QMessageBox::Yes | QMessageBox::No) != QMessageBox::Yes)) {
+    return false;
+  }
+
+  return true;
+}
+
+NMMImport::EResult NMMImport::installMod(const ModInfo &modInfo, ModeDialog::InstallMode mode, const QString &modPath,
+                           const QString &dataPath, const QString &modFolder, const TransferPlan &plan,
+                           const QStringList &subtrees, FileTransaction &transaction) const
+{
+  transaction.setCloneFiles(plan.strategy == Preflight::STRATEGY_CLONE);
+
+  if (!modInfo.virtualFolder.isEmpty()) {
+    return installModFolder(modInfo, mode, modPath, plan, transaction);
+  }
+
+  bool incomplete = false;
+
+  QString virtualFolder = NormalizedPath(modFolder + "/VirtualModActivator/").full();
+
+  // subtrees owned completely by this mod are renamed in one go. Those that fail
+  // are handled file by file like everything else
+  QStringList movedSubtrees;
+  foreach (const QString &subtree, subtrees) {
+    if (transaction.renameDirectory(dataPath + subtree, modPath + subtree)) {
+      movedSubtrees.append(subtree + "/");
+    }
+  }
+
+  // on the same volume copy-and-delete ends up the same as a move, minus the copying
+  bool moveFiles = (mode == ModeDialog::MODE_MOVE) || (plan.strategy == Preflight::STRATEGY_RENAME);
+  size_t savepoint = transaction.savepoint();
+  bool error = false;
+  // copies are handed to the transaction a slice at a time, the complete list is never built
+  std::vector<FileTransaction::Transfer> copies;
+  copies.reserve(FileTransaction::COPY_SLICE_SIZE);
+  auto flushCopies = [&] () {
+    if (MemoryProfile::active() != nullptr) {
+      MemoryProfile::addStructure("installMod.copySlice", static_cast<qint64>(copies.size()),
+                                  copies.capacity() * sizeof(FileTransaction::Transfer));
+    }
+    bool result = transaction.copyFiles(copies);
+    copies.clear();
+    return result;
+  };
+
+  for (size_t i = 0; (i < modInfo.files.size()) && !error; ++i) {
+    if (!modInfo.files[i].second || !plan.present[i]) {
+      // overwritten by another mod or removed since NMM installed it
+      incomplete = true;
+      continue;
+    }
+    NormalizedPath path = modInfo.files[i].first;
+    QString source = resolveSource(path, dataPath, virtualFolder);
+    if (source.isEmpty()) {
+      qWarning("unrecognized file path: %s", qPrintable(path.full()));
+      incomplete = true;
+      continue;
+    }
+    if (!movedSubtrees.isEmpty() && source.startsWith(dataPath) && isInSubtree(path.relative(), movedSubtrees)) {
+      continue;
+    }
+    // the journal keeps the path below the bases, sharing it with the file list
+    FileTransaction::Transfer transfer = {
+      source.left(source.size() - path.relative().size()), modPath, path
+    };
+    if (moveFiles) {
+      error = !transaction.moveFile(transfer);
+    } else {
+      // copies run several at a time
+      copies.push_back(transfer);
+      if (copies.size() == static_cast<size_t>(FileTransaction::COPY_SLICE_SIZE)) {
+        error = !flushCopies();
       }
     }
   }
+
+  if (!error && !copies.empty()) {
+    error = !flushCopies();
+  }
+
+  if (!error && !moveFiles && (mode == ModeDialog::MODE_COPYDELETE)) {
+    // copy successful, remove all sources in one go. The data directory itself has to stay
+    QStringList failures;
+    if (!transaction.removeCopySources(savepoint, dataPath, failures)) {
+      if (!transaction.isCancelled()) {
+        foreach (const QString &failure, failures) {
+          qWarning("%s", qPrintable(failure));
+        }
+        BackgroundTask::reportError(tr("%1 file(s) of \"%2\" couldn't be removed, for example:<ul><li>%3</li></ul>")
+                                    .arg(failures.size()).arg(modInfo.name).arg(failures.mid(0, 10).join("</li><li>")));
+      }
+      error = true;
+    }
+  }
+
   if (error) {
+    if (!transaction.isCancelled()) {
+      BackgroundTask::reportError(tr("Problem importing \"%1\", changes made for this mod will be undone: %2")
+                                  .arg(modInfo.name).arg(transaction.errorString()));
+    }
     return RES_FAILED;
   } else if (incomplete) {
     return RES_PARTIAL;
@@ -254,22 +681,140 @@ NMMImport::EResult NMMImport::installMod(const ModInfo &modInfo, ModeDialog::Ins
 }
 
 
-void NMMImport::transferMods(const std::vector<std::pair<QString, ModInfo> > &modList, QDomDocument &document,
-                             const QString &installLog, const QString &modFolder) const
+bool NMMImport::isInSubtree(const QStringRef &path, const QStringList &subtrees)
+{
+  foreach (const QString &subtree, subtrees) {
+    if (path.startsWith(subtree, Qt::CaseInsensitive)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+NMMImport::EResult NMMImport::installModFolder(const ModInfo &modInfo, ModeDialog::InstallMode mode,
+                                               const QString &modPath, const TransferPlan &plan,
+                                               FileTransaction &transaction) const
+{
+  // the folder contains exactly the files of this mod, laid out like the mod directory
+  // in MO. It can be transfered as a whole without looking at individual files
+  QString folderPath = QDir::cleanPath(modInfo.virtualFolder);
+  QStringList entries = m_FileSystem->entries(folderPath);
+
+  bool error = false;
+  if ((mode == ModeDialog::MODE_MOVE) || (plan.strategy == Preflight::STRATEGY_RENAME)) {
+    // on the same volume this is a rename of each top-level entry, directories included
+    for (auto iter = entries.begin(); (iter != entries.end()) && !error; ++iter) {
+      error = !transaction.move(folderPath + "/" + *iter, modPath + *iter);
+    }
+  } else {
+    for (auto iter = entries.begin(); (iter != entries.end()) && !error; ++iter) {
+      error = !transaction.copy(folderPath + "/" + *iter, modPath + *iter);
+    }
+    if (mode == ModeDialog::MODE_COPYDELETE) {
+      for (auto iter = entries.begin(); (iter != entries.end()) && !error; ++iter) {
+        error = !transaction.remove(folderPath + "/" + *iter, modPath + *iter);
+      }
+    }
+  }
+  if (!error && (mode != ModeDialog::MODE_COPYONLY)) {
+    // fails if NMM left anything else in there, which is fine
+    transaction.removeDirectory(folderPath);
+  }
+
+  if (error) {
+    if (!transaction.isCancelled()) {
+      BackgroundTask::reportError(tr("Problem importing \"%1\", changes made for this mod will be undone: %2")
+                                  .arg(modInfo.name).arg(transaction.errorString()));
+    }
+    return RES_FAILED;
+  } else {
+    return RES_SUCCESS;
+  }
+}
+
+
+void NMMImport::transferMods(std::vector<std::pair<QString, ModInfo> > &modList, QDomDocument &document,
+                             const QString &installLog, const QString &modFolder, InstallLogScanner *pendingFiles,
+                             const std::function<void ()> &fileListsRead) const
 {
   QProgressDialog progress(parentWidget());
+  progress.setWindowModality(Qt::WindowModal);
 
   // query which mods to transfer
   ModSelectionDialog modsDialog(parentWidget());
+  QSet<QString> existingNames = existingModNames();
+  QVariantHash importHistory = m_MOInfo->persistent(name(), "importedMods").toHash();
+  QHash<QString, QString> fingerprints;
 
   for (auto iter = modList.begin(); iter != modList.end(); ++iter) {
     if (iter->second.name != "ORIGINAL_VALUE") {
-      modsDialog.addMod(iter->first, iter->second.name, iter->second.version, iter->second.files.size());
+      modsDialog.addMod(iter->first, iter->second.name, iter->second.version,
+                        pendingFiles != nullptr ? -1 : static_cast<int>(iter->second.files.size()));
+    }
+  }
+
+  // mods imported before that haven't changed since, and still exist in MO, aren't
+  // preselected. That is only known once the file lists are complete
+  auto showFileLists = [&] {
+    for (auto iter = modList.begin(); iter != modList.end(); ++iter) {
+      if (iter->second.name != "ORIGINAL_VALUE") {
+        QString modFingerprint = fingerprint(iter->second);
+        fingerprints.insert(iter->first, modFingerprint);
+        // fingerprint and name of the MO mod it was imported into
+        QStringList previous = importHistory.value(iter->first).toStringList();
+        if ((previous.size() == 2) && (previous.at(0) == modFingerprint)
+            && existingNames.contains(previous.at(1).toCaseFolded())) {
+          modsDialog.setImportedBefore(iter->first);
+        }
+        modsDialog.setFileCount(iter->first, static_cast<int>(iter->second.files.size()));
+      }
     }
+  };
+
+  // the file lists are read while the user selects. The counts of the chunks parsed so
+  // far are displayed as they come in
+  CancellationToken fileCancel;
+  bool filesRead = (pendingFiles == nullptr);
+  BackgroundTask fileTask;
+  if (pendingFiles != nullptr) {
+    modsDialog.setLoading(true);
+    QObject::connect(&fileTask, &BackgroundTask::finished, &modsDialog, [&] {
+      if (filesRead) {
+        showFileLists();
+        modsDialog.setLoading(false);
+      } else {
+        modsDialog.reject();
+      }
+    });
+    fileTask.start([&] {
+      filesRead = readFileLists(*pendingFiles, document, installLog, modList, fileCancel,
+                                [&] (const std::vector<int> &counts) {
+        fileTask.post([&modsDialog, &modList, counts] {
+          for (size_t i = 0; i < counts.size(); ++i) {
+            modsDialog.setFileCount(modList[i].first, counts[i]);
+          }
+        });
+      });
+      pendingFiles->close();
+      if (filesRead) {
+        fileListsRead();
+      }
+    });
+  } else {
+    showFileLists();
   }
+
   if (modsDialog.exec() == QDialog::Rejected) {
+    fileCancel.cancel();
     return;
   }
+  fileTask.wait();
+  if (!filesRead) {
+    return;
+  }
+  if (MemoryProfile::active() != nullptr) {
+    profileModList(modList);
+  }
 
   // query the mode by which to transfer
   ModeDialog modeDialog(parentWidget());
@@ -277,120 +822,408 @@ void NMMImport::transferMods(const std::vector<std::pair<QString, ModInfo> > &mo
     return;
   }
 
-  // do it!
+  // the log only needs to be rewritten if files are taken away from NMM
+  bool updateLog = (modeDialog.getMode() == ModeDialog::MODE_COPYDELETE)
+                || (modeDialog.getMode() == ModeDialog::MODE_MOVE);
+
   std::vector<QString> enabledMods = modsDialog.getEnabledMods();
-  progress.setMaximum(enabledMods.size());
+
+  // refers into modList, which must not be resized from here on
+  std::map<QString, ModInfo*> modsByKey;
+  for (auto iter = modList.begin(); iter != modList.end(); ++iter) {
+    modsByKey[iter->first] = &iter->second;
+  }
+  // tree node with three links and the color next to the key and value, the key shares
+  // its data with modList
+  MemoryProfile::addStructure("modsByKey", modsByKey.size(),
+                              modsByKey.size() * (4 * sizeof(void*) + sizeof(QString) + sizeof(ModInfo*)));
+
+  ImportReport report;
+  QElapsedTimer stageTimer;
+  stageTimer.start();
+
+  // names are settled for all mods before anything is transfered, so the import itself
+  // runs unattended
+  std::map<QString, QString> modNames;
+  if (!resolveModNames(enabledMods, modsByKey, existingNames, modNames)) {
+    return;
+  }
+  for (auto iter = enabledMods.begin(); iter != enabledMods.end();) {
+    if (modNames.find(*iter) == modNames.end()) {
+      auto modIter = modsByKey.find(*iter);
+      report.addMod(*iter, modIter != modsByKey.end() ? modIter->second->name : QString());
+      iter = enabledMods.erase(iter);
+    } else {
+      ++iter;
+    }
+  }
+
+  // file operations run on a worker thread, everything touching the ui or MO stays here
+  BackgroundTask task(&progress);
+  ModeDialog::InstallMode mode = modeDialog.getMode();
+  QString dataPath = m_MOInfo->managedGame()->dataDirectory().absolutePath() + "/";
+
+  // everything from here on can be cancelled. The dialog stays up while the import
+  // winds down, by default it would hide right away
+  CancellationToken cancel;
+  QObject::disconnect(&progress, SIGNAL(canceled()), &progress, SLOT(cancel()));
+  QObject::connect(&progress, &QProgressDialog::canceled, [&] {
+    cancel.cancel();
+    progress.setLabelText(tr("Cancelling..."));
+  });
+  progress.setLabelText(tr("Checking files..."));
+  progress.setMaximum(0);
   progress.setValue(0);
-  progress.setCancelButton(nullptr);
   progress.show();
 
-  std::map<QString, ModInfo> modsByKey;
-  for (auto iter = modList.begin(); iter != modList.end(); ++iter) {
-    modsByKey[iter->first] = iter->second;
+  // number of file operations in flight, adjusted to what the disks involved handle best
+  ConcurrencyController concurrency(m_MOInfo->pluginSetting(name(), "io_queue_depth").toUInt(),
+                                    m_MOInfo->pluginSetting(name(), "adaptive_io").toBool());
+  QString traceFile = m_MOInfo->pluginSetting(name(), "trace_file").toString();
+  if (!traceFile.isEmpty()) {
+    concurrency.setTraceFile(traceFile);
+  }
+
+  // decide how to transfer each mod and make sure it will fit before touching anything
+  Preflight preflight(mode, m_MOInfo->modsPath(), *m_FileSystem);
+  preflight.setForceCopy(m_MOInfo->pluginSetting(name(), "copy_strategy").toString() == "copy");
+  preflight.setConcurrencyController(&concurrency);
+  std::map<QString, TransferPlan> plans;
+  qint64 requiredBytes = 0;
+  int missingFiles = 0;
+  bool planned = false;
+  CacheIndex cacheIndex;
+  DirectoryOwnership ownership;
+  MemoryProfile::beginPhase("preflight");
+  task.run([&] {
+    planned = planTransfer(enabledMods, modsByKey, preflight, dataPath, modFolder, plans,
+                           requiredBytes, missingFiles, cancel);
+    if (!planned) {
+      return;
+    }
+
+    // the archives NMM cached for the selected mods are looked up several times per mod
+    QStringList cacheArchives;
+    for (auto iter = enabledMods.begin(); iter != enabledMods.end(); ++iter) {
+      auto modIter = modsByKey.find(*iter);
+      if (modIter != modsByKey.end()) {
+        cacheArchives.append(modFolder + "/cache/" + modIter->second->installFile + ".zip");
+      }
+    }
+    cacheIndex.build(cacheArchives);
+
+    // when files are taken away from NMM, directories that belong to a single mod can be
+    // renamed as a whole. This has to take the files of all mods into account, not only
+    // the selected ones
+    if (mode != ModeDialog::MODE_COPYONLY) {
+      for (auto modIter = modList.begin(); modIter != modList.end(); ++modIter) {
+        for (auto fileIter = modIter->second.files.begin(); fileIter != modIter->second.files.end(); ++fileIter) {
+          NormalizedPath path = fileIter->first;
+          if (path.stripPrefix("Data/")) {
+            ownership.addFile(path, modIter->first);
+          }
+        }
+      }
+      ownership.groupSubtrees();
+    }
+  });
+  if (MemoryProfile::active() != nullptr) {
+    qint64 planBytes = 0;
+    for (auto iter = plans.begin(); iter != plans.end(); ++iter) {
+      planBytes += 4 * sizeof(void*) + sizeof(QString) + sizeof(TransferPlan) + iter->second.present.capacity();
+    }
+    MemoryProfile::addStructure("transferPlans", plans.size(), planBytes);
+  }
+  MemoryProfile::endPhase();
+  if (!planned || !confirmTransfer(preflight, requiredBytes, missingFiles)) {
+    return;
   }
+  report.setPreflightTime(stageTimer.elapsed());
+
+  // mods that weren't selected were only needed to determine ownership
+  QSet<QString> selectedKeys;
+  for (auto iter = enabledMods.begin(); iter != enabledMods.end(); ++iter) {
+    selectedKeys.insert(*iter);
+  }
+  for (auto modIter = modList.begin(); modIter != modList.end(); ++modIter) {
+    if (!selectedKeys.contains(modIter->first)) {
+      std::vector<std::pair<NormalizedPath, bool>>().swap(modIter->second.files);
+    }
+  }
+
+  // do it!
+  progress.setMaximum(enabledMods.size());
+  progress.setValue(0);
 
   QStringList incompleteMods;
+  QStringList removedKeys;
+
+  // journal of all file operations so a failed mod, or the whole import, can be undone
+  FileTransaction transaction(*m_FileSystem);
+  transaction.setCancellationToken(&cancel);
+  transaction.setConcurrencyController(&concurrency);
+  std::vector<IModInterface*> importedMods;
+
+  // partially imported mods whose overwritten files can be taken from the archive NMM cached
+  struct Restore {
+    QString key;
+    QString modName;
+    QString modPath;
+    QString archive;
+    std::unordered_set<NormalizedPath> files;
+    int restored;
+  };
+  std::vector<Restore> restores;
 
   bool error = false;
+  MemoryProfile::beginPhase("transfer");
   for (auto iter = enabledMods.begin(); iter != enabledMods.end() && !error; ++iter) {
+    if (cancel.isCancelled()) {
+      break;
+    }
     auto modIter = modsByKey.find(*iter);
     if (modIter == modsByKey.end()) {
       reportError(tr("invalid mod key \"%1\". This is a bug. The mod will not be transfered").arg(*iter));
       continue;
     }
+    ModInfo &modInfo = *modIter->second;
+    ImportReport::Mod &reportMod = report.addMod(*iter, modInfo.name);
 
-    QString modName = modIter->second.name;
-    if (!fixDirectoryName(modName)) {
-      modName.clear();
-    }
+    QString modName = modNames[*iter];
     progress.setLabelText(modName);
-    bool ok = true;
-    while (modName.isEmpty() || (m_MOInfo->getMod(modName) != nullptr)) {
-      modName = QInputDialog::getText(parentWidget(), tr("Mod exists!"),
-          tr("A mod with this name already exists or the name is invalid, please enter a new name or press "
-             "\"Cancel\" to skip import of this mod."), QLineEdit::Normal, modName, &ok);
-      fixDirectoryName(modName);
-      if (!ok || modName.isEmpty()) {
-        ok = false;
-        break;
-      }
-    }
-    if (!ok) {
-      continue;
-    }
+    reportMod.name = modName;
+    stageTimer.restart();
 
     // init new MO mod
-    IModInterface *mod = initMod(modName, modIter->second);
+    IModInterface *mod = initMod(modName);
     if (mod == nullptr) {
-      return;
+      // the mods imported so far still have to be finished like after any other failure
+      error = true;
+      reportMod.result = ImportReport::RESULT_FAILED;
+      reportMod.error = tr("failed to create the mod in MO");
+      break;
+    }
+    QString modPath = mod->absolutePath() + "/";
+
+    const TransferPlan &plan = plans[*iter];
+    reportMod.strategy = plan.strategy;
+    reportMod.files = plan.files;
+    reportMod.bytes = plan.bytes;
+    // folder mods are transfered as they are on disk, the log doesn't matter for them
+    for (size_t i = 0; i < plan.present.size(); ++i) {
+      if (!modInfo.files[i].second) {
+        ++reportMod.overwrittenFiles;
+      } else if (!plan.present[i]) {
+        ++reportMod.missingFiles;
+      }
     }
 
-    std::set<QString> extractFiles;
-    extractFiles.insert("data\\fomod\\info.xml");
-    extractFiles.insert("fomod\\info.xml");
-    unpackFiles(modFolder + "/cache/" + modIter->second.installFile + ".zip",
-                QDir::tempPath(),
-                extractFiles);
-
-    QString xmlPath = QDir::tempPath() + "/fomod/info.xml";
-    QFile infoXML(xmlPath);
-    if (infoXML.open(QIODevice::ReadOnly)) {
-      QDomDocument document("fomod");
-      if (document.setContent(&infoXML)) {
-        QDomElement tlEle = document.documentElement();
-
-        QString nexusID = getTextNodeValue(tlEle, "Id", true);
-        QString latestVer = getTextNodeValue(tlEle, "LastKnownVersion", true);
-        QString endorsedString = getTextNodeValue(tlEle, "IsEndorsed", true);
-        QString categoryId = getTextNodeValue(tlEle, "CategoryId", true);
-
-        mod->setNexusID(nexusID.toInt());
-        mod->setNewestVersion(latestVer);
-        mod->setIsEndorsed(endorsedString.compare("true", Qt::CaseInsensitive));
-        if (!categoryId.isEmpty()) {
-          mod->addNexusCategory(categoryId.toInt());
+    QString cacheArchive = modFolder + "/cache/" + modInfo.installFile + ".zip";
+    QString readmeArchive = modFolder + "/ReadMe/" + modInfo.installFile;
+    ModMetadata metadata = readMetadata(modInfo);
+    size_t savepoint = transaction.savepoint();
+    EResult res = RES_FAILED;
+    bool rolledBack = true;
+    task.run([&] {
+      QByteArray infoXML = readInfoXML(cacheArchive, cacheIndex.find(cacheArchive));
+      if (!infoXML.isEmpty() && !readInfoMetadata(infoXML, metadata)) {
+        qDebug("failed to parse info.xml of %s", qPrintable(cacheArchive));
+      }
+      reportMod.stageTimes[ImportReport::STAGE_PREPARE] = stageTimer.restart();
+
+      QStringList subtrees;
+      if (plan.strategy == Preflight::STRATEGY_RENAME) {
+        // directories with a listed file missing on disk. The count on disk could match
+        // anyway if unknown files took their place
+        QSet<NormalizedPath> incomplete;
+        for (size_t i = 0; i < plan.present.size(); ++i) {
+          if (plan.present[i]) {
+            continue;
+          }
+          NormalizedPath path = modInfo.files[i].first;
+          if (path.stripPrefix("Data/")) {
+            QString relativePath = path.relative().toString();
+            for (int separator = relativePath.lastIndexOf('/'); separator > 0;
+                 separator = relativePath.lastIndexOf('/', separator - 1)) {
+              incomplete.insert(NormalizedPath(relativePath.left(separator)));
+            }
+          }
+        }
+        foreach (const QString &subtree, ownership.ownedSubtrees(*iter)) {
+          // files not known to NMM (user-created or from other tools) must stay where they are
+          if (incomplete.contains(NormalizedPath(subtree))) {
+            continue;
+          }
+          int fileCount = 0;
+          m_FileSystem->directorySize(dataPath + subtree, fileCount);
+          if (fileCount == ownership.fileCount(subtree)) {
+            subtrees.append(subtree);
+          }
         }
-      } else {
-        qDebug("failed to parse %s", qPrintable(xmlPath));
       }
-      infoXML.remove();
-    } else {
-      qDebug("failed to open: %s", qPrintable(xmlPath));
-    }
-    // this may fail if the directory isn't empty otherwise. That's ok because it
-    // means the directory wasn't empty before
-    QDir().remove(QDir::tempPath() + "/fomod");
 
-    EResult res = installMod(modIter->second, modeDialog.getMode(), mod, modFolder);
+      res = installMod(modInfo, mode, modPath, dataPath, modFolder, plan, subtrees, transaction);
+      reportMod.stageTimes[ImportReport::STAGE_TRANSFER] = stageTimer.restart();
+      if (res == RES_FAILED) {
+        rolledBack = transaction.rollback(savepoint);
+        return;
+      }
+
+      if (m_FileSystem->type(readmeArchive) == FileSystem::TYPE_FILE) {
+        unpackFiles(readmeArchive, modPath + "readmes", std::unordered_set<NormalizedPath>());
+      }
+      reportMod.stageTimes[ImportReport::STAGE_README] = stageTimer.restart();
+    });
+
     if (res != RES_FAILED) {
-      if ((modeDialog.getMode() == ModeDialog::MODE_COPYDELETE) || ( modeDialog.getMode() == ModeDialog::MODE_MOVE)) {
-        removeModFromInstallLog(document, *iter);
+      reportMod.result = (res == RES_PARTIAL) ? ImportReport::RESULT_PARTIAL : ImportReport::RESULT_SUCCESS;
+      if (updateLog) {
+        removedKeys.append(*iter);
       }
       if (res == RES_PARTIAL) {
         incompleteMods.append(modName);
+        if ((reportMod.overwrittenFiles > 0) && modInfo.virtualFolder.isEmpty()
+            && (m_FileSystem->type(cacheArchive) == FileSystem::TYPE_FILE)) {
+          Restore restore { *iter, modName, modPath, cacheArchive,
+                            std::unordered_set<NormalizedPath>(), 0 };
+          for (auto fileIter = modInfo.files.begin(); fileIter != modInfo.files.end(); ++fileIter) {
+            if (!fileIter->second) {
+              // the archive may or may not contain the Data directory NMM installed into
+              NormalizedPath path = fileIter->first;
+              restore.files.insert(path);
+              if (path.stripPrefix("Data/")) {
+                restore.files.insert(NormalizedPath(path.relative().toString()));
+              }
+            }
+          }
+          restores.push_back(std::move(restore));
+        }
       }
+      importedMods.push_back(mod);
+      importHistory.insert(*iter, QStringList() << fingerprints.value(*iter) << modName);
     } else {
-      error = true;
+      // a cancelled mod is rolled back like a failed one, but the import ends normally
+      error = !cancel.isCancelled();
+      reportMod.result = error ? ImportReport::RESULT_FAILED : ImportReport::RESULT_CANCELLED;
+      reportMod.error = transaction.errorString();
+      if (!rolledBack) {
+        reportError(tr("Not all changes made while importing \"%1\" could be undone, "
+                       "please check the log for details.").arg(modName));
+      }
+      m_MOInfo->removeMod(mod);
+      break;
     }
 
-    QString readmeArchive = modFolder + "/ReadMe/" + modIter->second.installFile;
-    if (QFile::exists(readmeArchive)) {
-      unpackFiles(readmeArchive, mod->absolutePath() + "/readmes", std::set<QString>());
+    applyMetadata(mod, metadata);
+    progress.setValue(progress.value() + 1);
+
+    // the file list isn't needed anymore, don't keep it around for the rest of the import
+    std::vector<std::pair<NormalizedPath, bool>>().swap(modInfo.files);
+    plans.erase(*iter);
+  }
+
+  MemoryProfile::endPhase();
+
+  if (error && !importedMods.empty()
+      && (QMessageBox::question(parentWidget(), tr("Import failed"),
+            tr("The mod that failed to import has been restored. Do you also want to undo the import "
+               "of the %1 mod(s) imported before it?").arg(importedMods.size()),
+            QMessageBox::Yes | QMessageBox::No) == QMessageBox::Yes)) {
+    bool rolledBack = true;
+    task.run([&] { rolledBack = transaction.rollback(); });
+    if (!rolledBack) {
+      reportError(tr("Not all changes made during the import could be undone, please check the log for details."));
+    }
+    for (auto modIter = importedMods.rbegin(); modIter != importedMods.rend(); ++modIter) {
+      m_MOInfo->removeMod(*modIter);
     }
+    // NMM still owns everything, its log must stay as it was
+    updateLog = false;
+    incompleteMods.clear();
+    report.setUndone(true);
+    importedMods.clear();
+  }
+  // nothing is undone past this point, the journal would only take up memory
+  transaction.commit();
 
-    progress.setValue(progress.value() + 1);
-    m_MOInfo->modDataChanged(mod);
+  if (!importedMods.empty()) {
+    m_MOInfo->setPersistent(name(), "importedMods", importHistory);
   }
-  QFile::copy(installLog, installLog.mid(0).append(".backup"));
 
-  QFile installFile(installLog);
-  if (!installFile.open(QIODevice::WriteOnly)) {
-    reportError(tr("failed to update NMMs \"InstallLog.xml\""));
+  // files other mods overwrote in NMM can be restored now that the transfer is complete. One
+  // extraction pass per archive, the archives are processed in parallel
+  if (!importedMods.empty() && !restores.empty() && !cancel.isCancelled()) {
+    progress.setLabelText(tr("Restoring overwritten files..."));
+    task.run([&] {
+      BackgroundTask *current = BackgroundTask::current();
+      parallelFor(restores.size(), [&] (size_t index) {
+        BackgroundTask::attachThread(current);
+        if (cancel.isCancelled()) {
+          return;
+        }
+        Restore &restore = restores[index];
+        // parallelFor can't pass exceptions on. A failed allocation only costs this mod
+        // its restore, it stays incomplete
+        try {
+          restore.restored = unpackFiles(restore.archive, restore.modPath, restore.files,
+                                         cacheIndex.find(restore.archive), &cancel);
+        } catch (const std::exception &e) {
+          qWarning("failed to restore files of %s from %s: %s",
+                   qPrintable(restore.modName), qPrintable(restore.archive), e.what());
+          restore.restored = 0;
+        }
+      });
+    });
+    for (auto iter = restores.begin(); iter != restores.end(); ++iter) {
+      ImportReport::Mod *reportMod = report.findMod(iter->key);
+      if ((iter->restored == 0) || (reportMod == nullptr)) {
+        continue;
+      }
+      reportMod->restoredFiles = qMin(iter->restored, reportMod->overwrittenFiles);
+      if ((reportMod->restoredFiles == reportMod->overwrittenFiles) && (reportMod->missingFiles == 0)) {
+        reportMod->result = ImportReport::RESULT_SUCCESS;
+        incompleteMods.removeOne(iter->modName);
+      }
+    }
+    std::vector<Restore>().swap(restores);
+  }
+
+  // every change notification makes MO refresh its whole mod list, so the mods are only
+  // announced once all of them are in place
+  if (!importedMods.empty()) {
+    m_MOInfo->modDataChanged(importedMods.back());
+  }
+
+  // the log has to match the mods that were imported, this can't be cancelled anymore
+  report.setCancelled(cancel.isCancelled());
+  progress.setCancelButton(nullptr);
+  progress.setLabelText(tr("Updating InstallLog.xml..."));
+  stageTimer.restart();
+  if (updateLog && !removedKeys.isEmpty()) {
+    bool saved = false;
+    MemoryProfile::beginPhase("logUpdate");
+    task.run([&] { saved = saveInstallLog(document, installLog, removedKeys); });
+    MemoryProfile::endPhase();
+    if (!saved) {
+      reportError(tr("failed to update NMMs \"InstallLog.xml\""));
+    }
+  }
+  report.setLogUpdateTime(stageTimer.elapsed());
+  report.setMemoryProfile(MemoryProfile::active());
+
+  QString reportPath = qApp->property("dataPath").toString() + "/logs";
+  QString reportFile = reportPath + "/nmmimport_"
+                     + QDateTime::currentDateTime().toString("yyyyMMdd_hhmmss") + ".json";
+  if (QDir().mkpath(reportPath) && report.write(reportFile)) {
+    qDebug("import report written to %s", qPrintable(reportFile));
   } else {
-    QTextStream textStream(&installFile);
-    document.save(textStream, 0);
+    qWarning("failed to write import report to %s", qPrintable(reportFile));
+  }
+
+  if (cancel.isCancelled()) {
+    QMessageBox::information(parentWidget(), tr("Import cancelled"),
+        tr("The import was cancelled, %1 mod(s) were imported before that.").arg(importedMods.size()));
   }
-  installFile.close();
 
   if (incompleteMods.size() > 0) {
     QMessageBox::information(parentWidget(), tr("Incomplete Import"),
@@ -408,6 +1241,12 @@ void NMMImport::setParentWidget(QWidget *widget)
 
 void NMMImport::display() const
 {
+  setWorkerCount(m_MOInfo->pluginSetting(name(), "worker_threads").toUInt());
+  QScopedPointer<MemoryProfile> memoryProfile;
+  if (m_MOInfo->pluginSetting(name(), "memory_profile").toBool()) {
+    memoryProfile.reset(new MemoryProfile);
+  }
+
   QString installLog;
   QString modFolder;
   if (!determineNMMFolders(installLog, modFolder)) {
@@ -418,10 +1257,57 @@ void NMMImport::display() const
   std::vector<std::pair<QString, ModInfo>> modList;
   QDomDocument document("InstallLog");
 
-  if (!parseInstallLog(document, installLog, modList)) {
-    return;
+  InstallLogSnapshot snapshot(snapshotFile(), installLog);
+
+  // without a snapshot only the mods are read up front, their files are read while the
+  // user selects which to import
+  InstallLogScanner scanner(installLog);
+  bool filesPending = false;
+
+  {
+    // large logs take a moment to parse, allow backing out
+    QProgressDialog progress(parentWidget());
+    progress.setWindowModality(Qt::WindowModal);
+    progress.setLabelText(tr("Reading InstallLog.xml..."));
+    progress.setMaximum(0);
+    progress.show();
+    CancellationToken cancel;
+    QObject::connect(&progress, &QProgressDialog::canceled, [this, &cancel] {
+      cancel.cancel();
+      m_PrefetchCancel.cancel();
+    });
+    bool parsed = false;
+    BackgroundTask task(&progress);
+    MemoryProfile::beginPhase("parse");
+    task.run([&] {
+      // the prefetch may still be refreshing the snapshot
+      waitForPrefetch();
+      if (cancel.isCancelled()) {
+        return;
+      }
+      parsed = snapshot.read(modList);
+      if (parsed) {
+        return;
+      }
+      filesPending = scanner.open() && readInstallLogMods(scanner, modList);
+      if (filesPending) {
+        parsed = true;
+        return;
+      }
+      scanner.close();
+      modList.clear();
+      parsed = parseInstallLog(document, installLog, modList, cancel);
+      if (parsed && !snapshot.write(modList)) {
+        qWarning("failed to write snapshot of InstallLog.xml");
+      }
+    });
+    MemoryProfile::endPhase();
+    if (!parsed) {
+      return;
+    }
   }
 
+  VirtualModConfig virtualConfig(modFolder + "/VirtualModActivator");
   if (!QFile::exists(modFolder + "/VirtualModActivator/VirtualModConfig.xml")) {
     if (QMessageBox::warning(parentWidget(), tr("Pre-0.5 NMM"),
           tr("When importing from NMM versions before 0.5 MO can restore only the files installed on disc. This means "
@@ -429,17 +1315,32 @@ void NMMImport::display() const
           QMessageBox::Ok | QMessageBox::Cancel) == QMessageBox::Cancel) {
       return;
     }
+  } else if (virtualConfig.read()) {
+    // each mod sits in its own folder, import those as a whole
+    for (auto iter = modList.begin(); iter != modList.end(); ++iter) {
+      const VirtualModConfig::Mod *virtualMod = virtualConfig.findByFileName(iter->second.installFile);
+      if (virtualMod != nullptr) {
+        QString folder = virtualConfig.absoluteFolder(*virtualMod);
+        if (!folder.isEmpty() && QDir(folder).exists()) {
+          iter->second.virtualFolder = folder;
+        }
+      }
+    }
   } else {
     if (QMessageBox::warning(parentWidget(), tr("Post-0.5 NMM"),
-          tr("At the time this plugin was written, NMM 0.5 was in alpha state and its very possible it's not compatible "
-             "with the Beta/Final version."),
+          tr("The VirtualModConfig.xml of this NMM installation couldn't be read. Files will be imported "
+             "individually, files that exist in multiple mods will be imported into only one (the one installed last)."),
           QMessageBox::Ok | QMessageBox::Cancel) == QMessageBox::Cancel) {
       return;
     }
   }
 
   if (modList.size() > 1) {
-    transferMods(modList, document, installLog, modFolder);
+    transferMods(modList, document, installLog, modFolder, filesPending ? &scanner : nullptr, [&] {
+      if (!snapshot.write(modList)) {
+        qWarning("failed to write snapshot of InstallLog.xml");
+      }
+    });
   } else {
     QMessageBox::information(parentWidget(), tr("Nothing to import"),
                              tr("There are no mods installed by NMM."), QMessageBox::Ok);
@@ -554,6 +1455,69 @@ void NMMImport::removeModFromInstallLog(QDomDocument &document, const QString &k
 }
 
 
+bool NMMImport::saveInstallLog(QDomDocument &document, const QString &installLog,
+                               const QStringList &removedKeys) const
+{
+  // the original stays untouched by a successful update below, so linking it is as good
+  // as a copy. An existing backup is kept, it holds the state before the first import
+  QString backup = installLog + ".backup";
+  QString error;
+  bool linked = false;
+  if (m_FileSystem->type(backup) == FileSystem::TYPE_NONE) {
+    linked = m_FileSystem->linkFile(installLog, backup);
+    if (!linked && !m_FileSystem->cloneFile(installLog, backup)
+        && !m_FileSystem->copyFile(installLog, backup, error)) {
+      qWarning("failed to back up %s: %s", qPrintable(installLog), qPrintable(error));
+    }
+  }
+
+  bool saved = writeInstallLog(document, installLog, removedKeys);
+  if (!saved && linked && !m_FileSystem->removeFile(backup, error)) {
+    // the link still shares its data with the live log, NMM saving the log in place
+    // would change the backup as well
+    qWarning("failed to remove backup %s: %s", qPrintable(backup), qPrintable(error));
+  }
+  return saved;
+}
+
+bool NMMImport::writeInstallLog(QDomDocument &document, const QString &installLog,
+                                const QStringList &removedKeys) const
+{
+  // the log is replaced atomically, a crash in between leaves the original intact
+  {
+    QSet<QByteArray> keys;
+    foreach (const QString &key, removedKeys) {
+      keys.insert(key.toUtf8());
+    }
+    InstallLogScanner scanner(installLog);
+    bool written = false;
+    bool replaced = m_FileSystem->replaceFile(installLog, [&] (QIODevice &output) {
+      written = scanner.open() && scanner.writeWithout(output, keys);
+      // the log can't be replaced while it's mapped
+      scanner.close();
+      return written;
+    });
+    if (written) {
+      return replaced;
+    }
+  }
+
+  qDebug("InstallLog.xml not understood by the fast writer, using dom");
+  if (document.documentElement().isNull() && !loadInstallLog(document, installLog)) {
+    return false;
+  }
+  foreach (const QString &key, removedKeys) {
+    removeModFromInstallLog(document, key);
+  }
+  return m_FileSystem->replaceFile(installLog, [&document] (QIODevice &output) {
+    QTextStream textStream(&output);
+    document.save(textStream, 0);
+    textStream.flush();
+    return textStream.status() == QTextStream::Ok;
+  });
+}
+
+
 bool NMMImport::readMods(const QDomDocument &document, std::vector<std::pair<QString, ModInfo>> &modKeyList) const
 {
   try {
@@ -571,13 +1535,14 @@ bool NMMImport::readMods(const QDomDocument &document, std::vector<std::pair<QSt
     }
     return true;
   } catch (const MyException &e) {
-    reportError(tr("failed to parse \"modList\"-section of InstallLog.xml: %1").arg(e.what()));
+    BackgroundTask::reportError(tr("failed to parse \"modList\"-section of InstallLog.xml: %1").arg(e.what()));
     return false;
   }
 }
 
 
-bool NMMImport::readFiles(const QDomDocument &document, std::vector<std::pair<QString, ModInfo>> &modList) const
+bool NMMImport::readFiles(const QDomDocument &document, std::vector<std::pair<QString, ModInfo>> &modList,
+                          const CancellationToken &cancel) const
 {
   try {
     // create lookup map
@@ -588,18 +1553,22 @@ bool NMMImport::readFiles(const QDomDocument &document, std::vector<std::pair<QS
 
     QDomNodeList files = getNode(document.documentElement(), "dataFiles").childNodes();
     for (int i = 0; i < files.count(); ++i) {
+      if (cancel.isCancelled()) {
+        return false;
+      }
       QDomElement fileEle = files.at(i).toElement();
       if (fileEle.isNull()) {
         throw MyException(tr("unrecognized file structure"));
       }
-      QString path = fileEle.attribute("path");
+      NormalizedPath path(fileEle.attribute("path"));
 
       QDomNode mods = getNode(fileEle, "installingMods");
       for (QDomElement sourceEle = mods.firstChildElement(); !sourceEle.isNull(); sourceEle = sourceEle.nextSiblingElement()) {
         QString key = sourceEle.attribute("key");
         auto iter = modsByKey.find(key);
         if (iter == modsByKey.end()) {
-          qWarning("NMM Importer: data file \"%s\" references undeclared mod (key \"%s\")", qPrintable(path), qPrintable(key));
+          qWarning("NMM Importer: data file \"%s\" references undeclared mod (key \"%s\")", qPrintable(path.full()), qPrintable(key));
+          continue;
         }
         // ASSUMPTION: mod is the primary source if it's the last in the list
         iter->second->second.files.push_back(std::make_pair(path, sourceEle == mods.lastChildElement()));
@@ -607,7 +1576,7 @@ bool NMMImport::readFiles(const QDomDocument &document, std::vector<std::pair<QS
     }
     return true;
   } catch (const MyException &e) {
-    reportError(tr("failed to parse \"dataFiles\"-section of InstallLog.xml: %1").arg(e.what()));
+    BackgroundTask::reportError(tr("failed to parse \"dataFiles\"-section of InstallLog.xml: %1").arg(e.what()));
     return false;
   }
 }
@@ -643,7 +1612,7 @@ QString NMMImport::getLocalAppFolder()
   return QDir::fromNativeSeparators(ToQString(expanded));
 }
 
-QString NMMImport::digForSetting(QDomElement element) const
+QString NMMImport::digForSetting(QDomElement element, const QString &gameName)
 {
   /* <setting name="InstallInfoFolder" serializeAs="Xml">
       <value>
@@ -655,15 +1624,13 @@ QString NMMImport::digForSetting(QDomElement element) const
       </value>
   </setting> */
 
-  QString gameModeName = m_MOInfo->managedGame()->gameShortName();
-
   try {
     QDomNodeList items =
         getNode(
             getNode(element, "value").toElement(), "PerGameModeSettingsOfString").childNodes();
     for (int i = 0; i < items.count(); ++i) {
       QDomElement ele = items.at(i).toElement();
-      if (ele.attribute("modeId") == gameModeName) {
+      if (ele.attribute("modeId") == gameName) {
         QDomText text = ele.elementsByTagName("string").at(0).firstChild().toText();
         if (!text.isNull()) {
           return text.data();
@@ -705,7 +1672,7 @@ bool NMMImport::testModFolder(const QString &path, QString &problem)
 }
 
 
-bool NMMImport::determineNMMFolders(QString &installLog, QString &modFolder) const
+void NMMImport::readNMMFolders(const QString &gameName, QString &installLog, QString &modFolder)
 {
   modFolder.clear();
   installLog.clear();
@@ -755,13 +1722,27 @@ bool NMMImport::determineNMMFolders(QString &installLog, QString &modFolder) con
       for (QDomElement iter = node.firstChildElement("setting");
            iter != node.lastChildElement("setting"); iter = iter.nextSiblingElement("setting")) {
         if (iter.attribute("name") == "ModFolder") {
-          modFolder = QDir::fromNativeSeparators(digForSetting(iter));
+          modFolder = QDir::fromNativeSeparators(digForSetting(iter, gameName));
         } else if (iter.attribute("name") == "InstallInfoFolder") {
-          installLog = QDir::fromNativeSeparators(digForSetting(iter));
+          installLog = QDir::fromNativeSeparators(digForSetting(iter, gameName));
         }
       }
     }
   }
+}
+
+bool NMMImport::determineNMMFolders(QString &installLog, QString &modFolder) const
+{
+  bool prefetched = false;
+  {
+    std::lock_guard<std::mutex> lock(m_PrefetchMutex);
+    prefetched = m_Prefetched.foldersResolved;
+    installLog = m_Prefetched.installLog;
+    modFolder = m_Prefetched.modFolder;
+  }
+  if (!prefetched) {
+    readNMMFolders(m_MOInfo->managedGame()->gameShortName(), installLog, modFolder);
+  }
 
   // at this point we should usually have read our settings from the user.config
   // if not, ask the user
@@ -782,29 +1763,275 @@ bool NMMImport::determineNMMFolders(QString &installLog, QString &modFolder) con
 }
 
 
-bool NMMImport::parseInstallLog(QDomDocument &document, const QString &installLog,
-                                std::vector<std::pair<QString, ModInfo>> &modList) const
+QString NMMImport::snapshotFile() const
+{
+  QString cacheDirectory = m_MOInfo->pluginSetting(name(), "cache_directory").toString();
+  if (cacheDirectory.isEmpty()) {
+    cacheDirectory = qApp->property("dataPath").toString();
+  } else {
+    QDir().mkpath(cacheDirectory);
+  }
+  return cacheDirectory + "/nmmimport_installlog.snapshot";
+}
+
+void NMMImport::startPrefetch()
+{
+  if (!m_MOInfo->pluginSetting(name(), "prefetch").toBool() || (m_MOInfo->managedGame() == nullptr)) {
+    return;
+  }
+
+  setWorkerCount(m_MOInfo->pluginSetting(name(), "worker_threads").toUInt());
+  QString gameName = m_MOInfo->managedGame()->gameShortName();
+  QString snapshotPath = snapshotFile();
+  m_Prefetch = std::thread([this, gameName, snapshotPath] () {
+    // MO is still starting up, don't compete with it
+    ::SetThreadPriority(::GetCurrentThread(), THREAD_PRIORITY_LOWEST);
+
+    QString installLog;
+    QString modFolder;
+    try {
+      readNMMFolders(gameName, installLog, modFolder);
+    } catch (const std::exception &e) {
+      qWarning("failed to locate NMM in the background: %s", e.what());
+      return;
+    }
+    {
+      std::lock_guard<std::mutex> lock(m_PrefetchMutex);
+      m_Prefetched.installLog = installLog;
+      m_Prefetched.modFolder = modFolder;
+      m_Prefetched.foldersResolved = true;
+    }
+
+    QString logFile = installLog + "/InstallLog.xml";
+    if (installLog.isEmpty() || !QFile::exists(logFile)) {
+      return;
+    }
+
+    // only the snapshot is refreshed, display() reads the mods from it
+    InstallLogSnapshot snapshot(snapshotPath, logFile);
+    if (snapshot.isCurrent()) {
+      return;
+    }
+    // parsed on this thread alone, helper threads wouldn't run at its low priority
+    std::vector<std::pair<QString, ModInfo>> modList;
+    InstallLogScanner scanner(logFile);
+    if (!scanner.open() || !readInstallLog(scanner, modList, m_PrefetchCancel, 1)
+        || m_PrefetchCancel.isCancelled()) {
+      qDebug("InstallLog.xml not prefetched, it's read when the import is opened");
+    } else if (!snapshot.write(modList)) {
+      qWarning("failed to write snapshot of InstallLog.xml");
+    }
+  });
+}
+
+void NMMImport::waitForPrefetch() const
+{
+  if (m_Prefetch.joinable()) {
+    ::SetThreadPriority(m_Prefetch.native_handle(), THREAD_PRIORITY_NORMAL);
+    m_Prefetch.join();
+  }
+}
+
+bool NMMImport::readInstallLog(const InstallLogScanner &scanner,
+                               std::vector<std::pair<QString, ModInfo>> &modList, const CancellationToken &cancel,
+                               unsigned int threads) const
+{
+  return readInstallLogMods(scanner, modList) && readInstallLogFiles(scanner, modList, cancel, nullptr, threads);
+}
+
+
+bool NMMImport::readInstallLogMods(const InstallLogScanner &scanner,
+                                   std::vector<std::pair<QString, ModInfo>> &modList) const
+{
+  std::vector<InstallLogScanner::ModRecord> mods;
+  if (!scanner.readMods(mods)) {
+    return false;
+  }
+
+  modList.reserve(mods.size());
+  for (auto iter = mods.begin(); iter != mods.end(); ++iter) {
+    ModInfo info;
+    info.name = iter->name.toString();
+    info.version = iter->version.toString();
+    info.installFile = iter->path.toString();
+    modList.push_back(std::make_pair(iter->key.toString(), info));
+  }
+  return true;
+}
+
+
+bool NMMImport::readInstallLogFiles(const InstallLogScanner &scanner,
+                                    std::vector<std::pair<QString, ModInfo>> &modList, const CancellationToken &cancel,
+                                    const std::function<void (const std::vector<int>&)> &fileCounts,
+                                    unsigned int threads) const
+{
+  // the mods are listed again for their keys as raw bytes, in the same order as in modList.
+  // The scanner refuses keys containing entities so those can be compared directly
+  std::vector<InstallLogScanner::ModRecord> mods;
+  if (!scanner.readMods(mods) || (mods.size() != modList.size())) {
+    return false;
+  }
+  QHash<InstallLogScanner::Utf8View, size_t> modsByKey;
+  for (size_t i = 0; i < mods.size(); ++i) {
+    modsByKey[mods[i].key] = i;
+  }
+
+  struct FileEntry {
+    size_t mod;
+    NormalizedPath path;
+    bool primary;
+  };
+
+  // the dataFiles section is parsed in chunks on worker threads, each into its own list.
+  // Merging those in chunk order gives the same per-mod order as a serial parse
+  const QHash<InstallLogScanner::Utf8View, size_t> &lookup = modsByKey;
+  if (threads == 0) {
+    threads = workerCount();
+  }
+  std::vector<InstallLogScanner::Range> chunks = scanner.fileChunks(threads);
+  std::vector<std::vector<FileEntry>> chunkFiles(chunks.size());
+  std::vector<char> chunkValid(chunks.size(), 0);
+
+  // counts of the chunks done so far, for the caller to display while the rest is parsed
+  std::mutex countsMutex;
+  std::vector<int> partialCounts(fileCounts ? modList.size() : 0, 0);
+
+  parallelFor(chunks.size(), threads, [&] (size_t chunk) {
+    std::vector<FileEntry> &files = chunkFiles[chunk];
+    chunkValid[chunk] = scanner.readFiles(chunks[chunk], [&] (const InstallLogScanner::FileRecord &file) {
+      // the scan itself is cheap, once cancelled the remaining records are only skipped over
+      if (cancel.isCancelled()) {
+        return;
+      }
+      NormalizedPath path(file.path.toString());
+      for (auto keyIter = file.installingMods.begin(); keyIter != file.installingMods.end(); ++keyIter) {
+        auto modIter = lookup.constFind(*keyIter);
+        if (modIter == lookup.constEnd()) {
+          qWarning("NMM Importer: data file \"%s\" references undeclared mod (key \"%s\")",
+                   qPrintable(path.full()), qPrintable(keyIter->toString()));
+          continue;
+        }
+        // ASSUMPTION: mod is the primary source if it's the last in the list
+        FileEntry entry = { *modIter, path, keyIter + 1 == file.installingMods.end() };
+        files.push_back(entry);
+      }
+    });
+    if (fileCounts && chunkValid[chunk] && !cancel.isCancelled()) {
+      std::lock_guard<std::mutex> lock(countsMutex);
+      for (auto fileIter = files.begin(); fileIter != files.end(); ++fileIter) {
+        ++partialCounts[fileIter->mod];
+      }
+      fileCounts(partialCounts);
+    }
+  });
+
+  if (cancel.isCancelled() || (std::find(chunkValid.begin(), chunkValid.end(), 0) != chunkValid.end())) {
+    return false;
+  }
+
+  std::vector<size_t> modFileCounts(modList.size(), 0);
+  for (auto chunkIter = chunkFiles.begin(); chunkIter != chunkFiles.end(); ++chunkIter) {
+    for (auto fileIter = chunkIter->begin(); fileIter != chunkIter->end(); ++fileIter) {
+      ++modFileCounts[fileIter->mod];
+    }
+  }
+  for (size_t i = 0; i < modList.size(); ++i) {
+    modList[i].second.files.reserve(modFileCounts[i]);
+  }
+  for (auto chunkIter = chunkFiles.begin(); chunkIter != chunkFiles.end(); ++chunkIter) {
+    for (auto fileIter = chunkIter->begin(); fileIter != chunkIter->end(); ++fileIter) {
+      modList[fileIter->mod].second.files.push_back(std::make_pair(fileIter->path, fileIter->primary));
+    }
+    // release each chunk as soon as it's merged to keep the peak down
+    std::vector<FileEntry>().swap(*chunkIter);
+  }
+  return true;
+}
+
+
+bool NMMImport::readFileLists(const InstallLogScanner &scanner, QDomDocument &document, const QString &installLog,
+                              std::vector<std::pair<QString, ModInfo>> &modList, const CancellationToken &cancel,
+                              const std::function<void (const std::vector<int>&)> &fileCounts) const
+{
+  if (readInstallLogFiles(scanner, modList, cancel, fileCounts)) {
+#ifdef QT_DEBUG
+    // the fast path has to produce exactly what the dom parser does
+    std::vector<std::pair<QString, ModInfo>> domModList;
+    if (loadInstallLog(document, installLog)
+        && readMods(document, domModList) && readFiles(document, domModList, cancel)) {
+      Q_ASSERT(modList == domModList);
+    }
+#endif
+    return true;
+  }
+  if (cancel.isCancelled()) {
+    return false;
+  }
+
+  // the mods were understood, only their files have to go through the dom
+  qDebug("dataFiles of InstallLog.xml not understood by the fast parser, using dom parser");
+  for (auto iter = modList.begin(); iter != modList.end(); ++iter) {
+    std::vector<std::pair<NormalizedPath, bool>>().swap(iter->second.files);
+  }
+  return loadInstallLog(document, installLog) && !cancel.isCancelled()
+      && readFiles(document, modList, cancel);
+}
+
+
+bool NMMImport::loadInstallLog(QDomDocument &document, const QString &installLog) const
 {
   QFile installFile(installLog);
   if (!installFile.open(QIODevice::ReadOnly)) {
-    reportError(tr("\"%1\" not found").arg(installLog));
+    BackgroundTask::reportError(tr("\"%1\" not found").arg(installLog));
     return false;
   }
 
+  qint64 residentBefore = MemoryProfile::active() != nullptr ? MemoryProfile::residentSize() : 0;
+  bool res = document.setContent(&installFile);
+  installFile.close();
+  if (MemoryProfile::active() != nullptr) {
+    // the dom allocates inside QtXml, the growth of the process is the best estimate
+    MemoryProfile::addStructure("installLog.dom", 1, MemoryProfile::residentSize() - residentBefore);
+  }
+  if (!res) {
+    BackgroundTask::reportError(tr("failed to open InstallLog.xml"));
+  }
+  return res;
+}
+
+
+bool NMMImport::parseInstallLog(QDomDocument &document, const QString &installLog,
+                                std::vector<std::pair<QString, ModInfo>> &modList, const CancellationToken &cancel) const
+{
   {
-    bool res = document.setContent(&installFile);
-    installFile.close();
-    if (!res) {
-      reportError(tr("failed to open InstallLog.xml"));
-      return false;
+    InstallLogScanner scanner(installLog);
+    if (scanner.open() && readInstallLog(scanner, modList, cancel)) {
+#ifdef QT_DEBUG
+      // the fast path has to produce exactly what the dom parser does
+      std::vector<std::pair<QString, ModInfo>> domModList;
+      if (loadInstallLog(document, installLog)
+          && readMods(document, domModList) && readFiles(document, domModList, cancel)) {
+        Q_ASSERT(modList == domModList);
+      }
+#endif
+      return true;
     }
   }
+  if (cancel.isCancelled()) {
+    return false;
+  }
+
+  qDebug("InstallLog.xml not understood by the fast parser, using dom parser");
+  modList.clear();
+  if (!loadInstallLog(document, installLog) || cancel.isCancelled()) {
+    return false;
+  }
 
   if (!readMods(document, modList)) {
     return false;
   }
 
-  if (!readFiles(document, modList)) {
+  if (!readFiles(document, modList, cancel)) {
     return false;
   }
 
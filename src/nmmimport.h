@@ -24,11 +24,23 @@ along with NMM Import plugin.  If not, see <http://www.gnu.org/licenses/>.
 #include <imoinfo.h>
 #include <archive.h>
 #include "modedialog.h"
+#include "normalizedpath.h"
+#include "filesystem.h"
+#include "cancellation.h"
+#include "installlogscanner.h"
+#include "filetransaction.h"
+#include "preflight.h"
+#include "importreport.h"
+#include "zipdirectory.h"
 
 #include <QProgressDialog>
 #include <QtXml>
 
-#include <set>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <unordered_set>
 #include <vector>
 
 
@@ -57,18 +69,43 @@ public:
   virtual QString tooltip() const;
   virtual QIcon icon() const;
 
+  /**
+   * @brief use a different file system for all transfers, i.e. a MemoryFileSystem to
+   *        benchmark the import without the disk
+   * @note the file system has to outlive the import
+   */
+  void setFileSystem(FileSystem &fileSystem) { m_FileSystem = &fileSystem; }
+
 public slots:
   virtual void display() const;
 
 private:
 
+  friend class InstallLogSnapshot;
+
   struct ModInfo {
     QString name;
     QString version;
     QString installFile;
     int nexusID;
 
-    std::vector<std::pair<QString, bool> > files;
+    std::vector<std::pair<NormalizedPath, bool> > files;
+
+    // NMM 0.5+: folder below VirtualModActivator holding all files of this mod
+    QString virtualFolder;
+
+    bool operator==(const ModInfo &other) const;
+  };
+
+  /**
+   * @brief how the files of a mod are transfered, determined before anything is changed
+   */
+  struct TransferPlan {
+    Preflight::EStrategy strategy { Preflight::STRATEGY_COPY };
+    qint64 bytes { 0 };
+    int files { 0 };
+    // for each entry in ModInfo::files whether the source exists. Empty for folder mods
+    std::vector<char> present;
   };
 
   enum EResult {
@@ -77,6 +114,18 @@ private:
     RES_SUCCESS
   };
 
+  /**
+   * @brief meta data of a mod, collected from the log and info.xml and applied to the mod at once
+   */
+  struct ModMetadata {
+    QString version;
+    int nexusID { 0 };
+    bool hasInfo { false }; // newestVersion and endorsed are only known from info.xml
+    QString newestVersion;
+    bool endorsed { false };
+    int category { -1 }; // -1 if unknown
+  };
+
 private:
 
   static QDomNode getNode(const QDomElement &parent, const QString &displayName, bool mayBeEmpty = false);
@@ -84,28 +133,104 @@ private:
   static QString getLocalAppFolder();
   static bool testInstallLog(const QString &path, QString &problem);
   static bool testModFolder(const QString &path, QString &problem);
+  static bool isInSubtree(const QStringRef &path, const QStringList &subtrees);
+  static QString fingerprint(const ModInfo &modInfo);
+  static void profileModList(const std::vector<std::pair<QString, ModInfo>> &modList);
+  static QString resolveSource(NormalizedPath &path, const QString &dataPath, const QString &virtualFolder);
+  static QString digForSetting(QDomElement element, const QString &gameName);
+  static void readNMMFolders(const QString &gameName, QString &installLog, QString &modFolder);
+  static ModMetadata readMetadata(const ModInfo &info);
+  static bool readInfoMetadata(const QByteArray &infoXML, ModMetadata &metadata);
+  static void applyMetadata(MOBase::IModInterface *mod, const ModMetadata &metadata);
 
-  QString digForSetting(QDomElement element) const;
   bool determineNMMFolders(QString &installLog, QString &modFolder) const;
-
-  void unpackFiles(const QString &archiveFile, const QString &outputDirectory, const std::set<QString> &extractFiles) const;
-  MOBase::IModInterface *initMod(const QString &modName, const ModInfo &info) const;
-  EResult installMod(const ModInfo &modInfo, ModeDialog::InstallMode mode, MOBase::IModInterface *mod, const QString &modFolder) const;
+  QString snapshotFile() const;
+
+  /**
+   * @brief resolve the NMM folders and refresh the snapshot of the log on a low priority
+   *        thread
+   *
+   * Opening the tool usually finds the snapshot current. The parsed mods are not kept,
+   * they would stay in memory for the whole session. Nothing is shown to the user,
+   * anything that goes wrong here is done again by display()
+   */
+  void startPrefetch();
+
+  /**
+   * @brief wait for the prefetch to finish, at normal priority now that the user waits
+   */
+  void waitForPrefetch() const;
+
+  int unpackFiles(const QString &archiveFile, const QString &outputDirectory, const std::unordered_set<NormalizedPath> &extractFiles,
+                  const ZipDirectory *directory = nullptr, const CancellationToken *cancel = nullptr) const;
+  bool writeFile(const QString &fileName, const QByteArray &content) const;
+  QByteArray readInfoXML(const QString &archiveFile, const ZipDirectory *directory) const;
+  MOBase::IModInterface *initMod(const QString &modName) const;
+  QSet<QString> existingModNames() const;
+  bool resolveModNames(const std::vector<QString> &modKeys, const std::map<QString, ModInfo*> &modsByKey,
+                       const QSet<QString> &existingNames, std::map<QString, QString> &modNames) const;
+  bool planTransfer(const std::vector<QString> &modKeys, const std::map<QString, ModInfo*> &modsByKey,
+                    Preflight &preflight, const QString &dataPath, const QString &modFolder,
+                    std::map<QString, TransferPlan> &plans, qint64 &requiredBytes, int &missingFiles,
+                    const CancellationToken &cancel) const;
+  bool confirmTransfer(const Preflight &preflight, qint64 requiredBytes, int missingFiles) const;
+  EResult installMod(const ModInfo &modInfo, ModeDialog::InstallMode mode, const QString &modPath, const QString &dataPath,
+                     const QString &modFolder, const TransferPlan &plan, const QStringList &subtrees,
+                     FileTransaction &transaction) const;
+  EResult installModFolder(const ModInfo &modInfo, ModeDialog::InstallMode mode, const QString &modPath,
+                           const TransferPlan &plan, FileTransaction &transaction) const;
 
   bool readMods(const QDomDocument &document, std::vector<std::pair<QString, ModInfo>> &modList) const;
-  bool readFiles(const QDomDocument &document, std::vector<std::pair<QString, ModInfo>> &modList) const;
-  bool parseInstallLog(QDomDocument &document, const QString &installLog, std::vector<std::pair<QString, ModInfo> > &modList) const;
+  bool readFiles(const QDomDocument &document, std::vector<std::pair<QString, ModInfo>> &modList,
+                 const CancellationToken &cancel) const;
+  bool readInstallLog(const InstallLogScanner &scanner, std::vector<std::pair<QString, ModInfo>> &modList,
+                      const CancellationToken &cancel, unsigned int threads = 0) const;
+  bool readInstallLogMods(const InstallLogScanner &scanner, std::vector<std::pair<QString, ModInfo>> &modList) const;
+  bool readInstallLogFiles(const InstallLogScanner &scanner, std::vector<std::pair<QString, ModInfo>> &modList,
+                           const CancellationToken &cancel,
+                           const std::function<void (const std::vector<int>&)> &fileCounts = nullptr,
+                           unsigned int threads = 0) const;
+  bool readFileLists(const InstallLogScanner &scanner, QDomDocument &document, const QString &installLog,
+                     std::vector<std::pair<QString, ModInfo>> &modList, const CancellationToken &cancel,
+                     const std::function<void (const std::vector<int>&)> &fileCounts) const;
+  bool loadInstallLog(QDomDocument &document, const QString &installLog) const;
+  bool parseInstallLog(QDomDocument &document, const QString &installLog, std::vector<std::pair<QString, ModInfo> > &modList,
+                       const CancellationToken &cancel) const;
   void removeModFromInstallLog(QDomDocument &document, const QString &key) const;
-
-  void transferMods(const std::vector<std::pair<QString, ModInfo>> &modList, QDomDocument &document, const QString &installLog, const QString &modFolder) const;
+  bool saveInstallLog(QDomDocument &document, const QString &installLog, const QStringList &removedKeys) const;
+  bool writeInstallLog(QDomDocument &document, const QString &installLog, const QStringList &removedKeys) const;
+
+  /**
+   * @param pendingFiles if not null the file lists in modList are still empty and read
+   *                     through this scanner while the user selects the mods. It is
+   *                     closed afterwards
+   * @param fileListsRead called on the worker once pending file lists are complete
+   */
+  void transferMods(std::vector<std::pair<QString, ModInfo>> &modList, QDomDocument &document, const QString &installLog,
+                    const QString &modFolder, InstallLogScanner *pendingFiles,
+                    const std::function<void ()> &fileListsRead) const;
 
   virtual void setParentWidget(QWidget *widget);
 
 private:
 
   MOBase::IOrganizer *m_MOInfo { nullptr };
+  FileSystem *m_FileSystem { &FileSystem::real() };
 
   Archive *m_ArchiveHandler;
+  // the archive library handles one archive at a time
+  mutable std::mutex m_ArchiveMutex;
+
+  struct Prefetched {
+    QString installLog;
+    QString modFolder;
+    bool foldersResolved { false };
+  };
+
+  mutable std::thread m_Prefetch;
+  mutable std::mutex m_PrefetchMutex;
+  mutable CancellationToken m_PrefetchCancel;
+  mutable Prefetched m_Prefetched;
 
 };
 
@@ -0,0 +1,72 @@
+/*
+Copyright (C) 2012 Sebastian Herbord. All rights reserved.
+
+This file is part of NMM Import plugin for MO
+
+NMM Import plugin is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+NMM Import plugin is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with NMM Import plugin.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "normalizedpath.h"
+
+
+NormalizedPath::NormalizedPath()
+  : m_Offset(0), m_Hash(0)
+{
+}
+
+NormalizedPath::NormalizedPath(const QString &path)
+  : m_Path(path), m_Offset(0), m_Hash(0)
+{
+  m_Path.replace('\\', '/');
+
+  // same mixing as qHash(QString), but on the case-folded characters so that
+  // paths differing only in case end up in the same bucket
+  const QChar *data = m_Path.constData();
+  for (int i = 0; i < m_Path.size(); ++i) {
+    m_Hash = (m_Hash << 4) + data[i].toCaseFolded().unicode();
+    m_Hash ^= (m_Hash & 0xf0000000) >> 23;
+    m_Hash &= 0x0fffffff;
+  }
+}
+
+NormalizedPath::NormalizedPath(const QString &path, uint hash)
+  : m_Path(path), m_Offset(0), m_Hash(hash)
+{
+}
+
+bool NormalizedPath::stripPrefix(const QString &prefix)
+{
+  if (relative().startsWith(prefix, Qt::CaseInsensitive)) {
+    m_Offset += prefix.size();
+    return true;
+  } else {
+    return false;
+  }
+}
+
+bool NormalizedPath::stripComponent()
+{
+  int index = m_Path.indexOf('/', m_Offset);
+  if (index == -1) {
+    return false;
+  }
+  m_Offset = index + 1;
+  return true;
+}
+
+bool NormalizedPath::operator==(const NormalizedPath &other) const
+{
+  return (m_Hash == other.m_Hash)
+      && (m_Path.compare(other.m_Path, Qt::CaseInsensitive) == 0);
+}
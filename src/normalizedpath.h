@@ -0,0 +1,105 @@
+/*
+Copyright (C) 2012 Sebastian Herbord. All rights reserved.
+
+This file is part of NMM Import plugin for MO
+
+NMM Import plugin is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+NMM Import plugin is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with NMM Import plugin.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef NORMALIZEDPATH_H
+#define NORMALIZEDPATH_H
+
+#include <QString>
+#include <functional>
+
+
+/**
+ * @brief a file path with '/' as separator and a precomputed case insensitive hash
+ *
+ * NMM records paths with native separators and in whatever case the mod author chose.
+ * Separators are normalized and the case-folded hash is computed once on construction,
+ * so comparisons and set lookups don't have to lowercase the string again. Leading
+ * directories can be stripped by offset without copying the string.
+ */
+class NormalizedPath
+{
+public:
+
+  NormalizedPath();
+  explicit NormalizedPath(const QString &path);
+
+  /**
+   * @brief restore a path stored earlier
+   * @param path the complete path as returned by full(), already using '/' as separator
+   * @param hash the hash as returned by hash() for that path
+   */
+  NormalizedPath(const QString &path, uint hash);
+
+  /**
+   * @return the complete path, independent of stripped prefixes
+   */
+  const QString &full() const { return m_Path; }
+
+  /**
+   * @return the path without the prefixes stripped so far
+   */
+  QStringRef relative() const { return m_Path.midRef(m_Offset); }
+
+  /**
+   * @brief remove a leading directory from the relative path
+   * @param prefix the prefix to remove, using '/' as separator and ending on a '/'.
+   *               The comparison is case insensitive
+   * @return true if the relative path started with the prefix and it was removed
+   */
+  bool stripPrefix(const QString &prefix);
+
+  /**
+   * @brief remove the first directory from the relative path
+   * @return true if there was a directory to remove
+   */
+  bool stripComponent();
+
+  /**
+   * @return hash of the case-folded complete path
+   */
+  uint hash() const { return m_Hash; }
+
+  bool isEmpty() const { return m_Path.isEmpty(); }
+
+  /**
+   * @brief case insensitive comparison of the complete paths
+   */
+  bool operator==(const NormalizedPath &other) const;
+  bool operator!=(const NormalizedPath &other) const { return !(*this == other); }
+
+private:
+
+  QString m_Path;
+  int m_Offset;
+  uint m_Hash;
+
+};
+
+inline uint qHash(const NormalizedPath &path, uint seed = 0)
+{
+  return path.hash() ^ seed;
+}
+
+namespace std {
+template <> struct hash<NormalizedPath> {
+  size_t operator()(const NormalizedPath &path) const { return path.hash(); }
+};
+}
+
+#endif // NORMALIZEDPATH_H
@@ -0,0 +1,103 @@
+/*
+Copyright (C) 2012 Sebastian Herbord. All rights reserved.
+
+This file is part of NMM Import plugin for MO
+
+NMM Import plugin is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+NMM Import plugin is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with NMM Import plugin.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef PARALLEL_H
+#define PARALLEL_H
+
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+
+namespace detail {
+
+inline std::atomic<unsigned int> &configuredWorkerCount()
+{
+  static std::atomic<unsigned int> count(0);
+  return count;
+}
+
+} // namespace detail
+
+
+/**
+ * @brief override the number of threads used for work that can be split up
+ * @param count number of threads, 0 to use one per processor
+ */
+inline void setWorkerCount(unsigned int count)
+{
+  detail::configuredWorkerCount() = count;
+}
+
+/**
+ * @return the number of threads used for work that can be split up
+ */
+inline unsigned int workerCount()
+{
+  unsigned int count = detail::configuredWorkerCount();
+  return count != 0 ? count : std::max(1u, std::thread::hardware_concurrency());
+}
+
+
+/**
+ * @brief call func for every index in [0, count) on up to threadLimit threads
+ * @param count number of work items
+ * @param threadLimit maximum number of threads to use, including the calling one
+ * @param func functor taking the index of the item to process. It must not throw
+ * @note blocks until all items are processed. The calling thread does its share of the work
+ */
+template <typename Func>
+void parallelFor(size_t count, unsigned int threadLimit, Func func)
+{
+  size_t threadCount = std::min<size_t>(count, threadLimit);
+  if (threadCount <= 1) {
+    for (size_t i = 0; i < count; ++i) {
+      func(i);
+    }
+    return;
+  }
+
+  std::atomic<size_t> next(0);
+  auto worker = [&] () {
+    for (size_t i = next++; i < count; i = next++) {
+      func(i);
+    }
+  };
+
+  std::vector<std::thread> threads;
+  for (size_t i = 1; i < threadCount; ++i) {
+    threads.push_back(std::thread(worker));
+  }
+  worker();
+  for (auto iter = threads.begin(); iter != threads.end(); ++iter) {
+    iter->join();
+  }
+}
+
+/**
+ * @brief call func for every index in [0, count) on up to workerCount() threads
+ */
+template <typename Func>
+void parallelFor(size_t count, Func func)
+{
+  parallelFor(count, workerCount(), func);
+}
+
+#endif // PARALLEL_H
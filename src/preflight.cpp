@@ -0,0 +1,104 @@
+/*
+Copyright (C) 2012 Sebastian Herbord. All rights reserved.
+
+This file is part of NMM Import plugin for MO
+
+NMM Import plugin is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+NMM Import plugin is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with NMM Import plugin.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "preflight.h"
+#include "parallel.h"
+
+#include <QElapsedTimer>
+#include <algorithm>
+#include <atomic>
+
+
+namespace {
+
+// stat calls are cheap, hand them to the threads in larger batches
+const size_t PROBE_BATCH_SIZE = 512;
+
+}
+
+
+Preflight::Preflight(ModeDialog::InstallMode mode, const QString &destination, FileSystem &fileSystem)
+  : m_Mode(mode), m_Destination(destination), m_FileSystem(fileSystem)
+  , m_DestinationVolume(fileSystem.volume(destination))
+{
+}
+
+Preflight::EStrategy Preflight::strategy(const QString &sourceDirectory)
+{
+  QString sourceVolume = m_FileSystem.volume(sourceDirectory);
+  auto iter = m_Strategies.find(sourceVolume);
+  if (iter != m_Strategies.end()) {
+    return *iter;
+  }
+
+  bool sameVolume = !sourceVolume.isEmpty() && (sourceVolume == m_DestinationVolume);
+  EStrategy result = STRATEGY_COPY;
+  if (m_Mode == ModeDialog::MODE_COPYONLY) {
+    // both sides stay in use so they must not share a file. Clones only share data
+    // until one of them is modified
+    if (!m_ForceCopy && sameVolume && m_FileSystem.supportsCloning(sourceDirectory, m_Destination)) {
+      result = STRATEGY_CLONE;
+    }
+  } else if (sameVolume && (!m_ForceCopy || (m_Mode == ModeDialog::MODE_MOVE))) {
+    // the source is removed anyway, for copy-and-delete a rename has the same outcome
+    result = STRATEGY_RENAME;
+  }
+  qDebug("transfer strategy for %s: %d", qPrintable(sourceVolume), result);
+  m_Strategies.insert(sourceVolume, result);
+  return result;
+}
+
+qint64 Preflight::bytesAvailable() const
+{
+  return m_FileSystem.bytesAvailable(m_Destination);
+}
+
+QString Preflight::destinationVolume() const
+{
+  return m_DestinationVolume;
+}
+
+qint64 Preflight::probeFiles(const QStringList &files, std::vector<char> &present, const CancellationToken *cancel) const
+{
+  present.assign(files.size(), 0);
+  std::atomic<qint64> totalSize(0);
+  size_t batchCount = (files.size() + PROBE_BATCH_SIZE - 1) / PROBE_BATCH_SIZE;
+  unsigned int concurrency = m_Concurrency != nullptr ? m_Concurrency->concurrency() : workerCount();
+  QElapsedTimer timer;
+  timer.start();
+  parallelFor(batchCount, concurrency, [&] (size_t batch) {
+    if ((cancel != nullptr) && cancel->isCancelled()) {
+      return;
+    }
+    qint64 batchSize = 0;
+    size_t end = std::min<size_t>((batch + 1) * PROBE_BATCH_SIZE, files.size());
+    for (size_t i = batch * PROBE_BATCH_SIZE; i < end; ++i) {
+      qint64 size = m_FileSystem.fileSize(files.at(static_cast<int>(i)));
+      if (size >= 0) {
+        present[i] = 1;
+        batchSize += size;
+      }
+    }
+    totalSize += batchSize;
+  });
+  if (m_Concurrency != nullptr) {
+    m_Concurrency->record(files.size(), 0, timer.nsecsElapsed() / 1000, concurrency);
+  }
+  return totalSize;
+}
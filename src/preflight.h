@@ -0,0 +1,119 @@
+/*
+Copyright (C) 2012 Sebastian Herbord. All rights reserved.
+
+This file is part of NMM Import plugin for MO
+
+NMM Import plugin is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+NMM Import plugin is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with NMM Import plugin.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef PREFLIGHT_H
+#define PREFLIGHT_H
+
+#include "cancellation.h"
+#include "concurrencycontroller.h"
+#include "filesystem.h"
+#include "modedialog.h"
+
+#include <QCoreApplication>
+#include <QHash>
+#include <QString>
+#include <QStringList>
+#include <vector>
+
+
+/**
+ * @brief inspects the file systems involved before anything is transfered
+ *
+ * Decides per source location how files get into the mod directory (rename, clone or
+ * copy) and gathers what is needed to check up front that the import fits on the
+ * destination volume.
+ */
+class Preflight
+{
+
+  Q_DECLARE_TR_FUNCTIONS(Preflight)
+
+public:
+
+  enum EStrategy {
+    STRATEGY_RENAME, // same volume, files are renamed
+    STRATEGY_CLONE,  // same volume with copy-on-write support, files are cloned
+    STRATEGY_COPY    // data is copied (and possibly removed from the source afterwards)
+  };
+
+public:
+
+  /**
+   * @param mode the transfer mode selected by the user
+   * @param destination directory mods are created in
+   * @param fileSystem the file system sources and destination are on
+   */
+  Preflight(ModeDialog::InstallMode mode, const QString &destination,
+            FileSystem &fileSystem = FileSystem::real());
+
+  /**
+   * @brief fastest strategy that is safe for files below the specified directory
+   * @note the file system is probed once per volume
+   */
+  EStrategy strategy(const QString &sourceDirectory);
+
+  /**
+   * @brief always copy the data when the mode keeps or deletes the sources, even where
+   *        renaming or cloning would be possible. Has to be set before the first call
+   *        to strategy
+   */
+  void setForceCopy(bool forceCopy) { m_ForceCopy = forceCopy; }
+
+  /**
+   * @brief let the controller decide how many files are probed at the same time
+   */
+  void setConcurrencyController(ConcurrencyController *controller) { m_Concurrency = controller; }
+
+  /**
+   * @return true if the strategy needs space on the destination volume for the full file size
+   */
+  static bool needsSpace(EStrategy strategy) { return strategy == STRATEGY_COPY; }
+
+  /**
+   * @return free space on the destination volume available to the user
+   */
+  qint64 bytesAvailable() const;
+
+  /**
+   * @return root of the destination volume, for display purposes
+   */
+  QString destinationVolume() const;
+
+  /**
+   * @brief check existence and size of many files in parallel
+   * @param files absolute paths of the files
+   * @param present receives for each file whether it exists
+   * @param cancel stops probing early, the remaining files are reported as missing
+   * @return the accumulated size of the existing files
+   */
+  qint64 probeFiles(const QStringList &files, std::vector<char> &present, const CancellationToken *cancel = nullptr) const;
+
+private:
+
+  ModeDialog::InstallMode m_Mode;
+  QString m_Destination;
+  FileSystem &m_FileSystem;
+  QString m_DestinationVolume;
+  QHash<QString, EStrategy> m_Strategies;
+  bool m_ForceCopy { false };
+  ConcurrencyController *m_Concurrency { nullptr };
+
+};
+
+#endif // PREFLIGHT_H
@@ -0,0 +1,109 @@
+/*
+Copyright (C) 2012 Sebastian Herbord. All rights reserved.
+
+This file is part of NMM Import plugin for MO
+
+NMM Import plugin is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+NMM Import plugin is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with NMM Import plugin.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "virtualmodconfig.h"
+#include "normalizedpath.h"
+
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QXmlStreamReader>
+
+
+VirtualModConfig::VirtualModConfig(const QString &virtualFolder)
+  : m_VirtualFolder(QDir::fromNativeSeparators(virtualFolder))
+{
+}
+
+bool VirtualModConfig::read()
+{
+  /* <virtualModActivator fileVersion="0.3.0.0">
+      <modList>
+        <modInfo modId="3863" modName="SkyUI" modFileName="SkyUI_5_1-3863-5-1.7z" ...>
+          <fileLink realPath="SkyUI_5_1-3863-5-1\interface\skyui.swf" virtualPath="Data\interface\skyui.swf" ... />
+        </modInfo>
+      </modList>
+  </virtualModActivator> */
+
+  QFile file(m_VirtualFolder + "/VirtualModConfig.xml");
+  if (!file.open(QIODevice::ReadOnly)) {
+    return false;
+  }
+
+  QString virtualPrefix = NormalizedPath(m_VirtualFolder + "/").full();
+
+  m_Mods.clear();
+  m_ModsByFileName.clear();
+
+  // the file lists every linked file, the stream reader keeps this cheap even though
+  // only the first link of each mod is of interest
+  QXmlStreamReader reader(&file);
+  int current = -1;
+  while (!reader.atEnd()) {
+    reader.readNext();
+    if (reader.isStartElement()) {
+      QXmlStreamAttributes attributes = reader.attributes();
+      if (reader.name() == "modInfo") {
+        Mod mod;
+        mod.name = attributes.value("modName").toString();
+        mod.fileName = attributes.value("modFileName").toString();
+        mod.nexusID = attributes.value("modId").toString().toInt();
+        current = static_cast<int>(m_Mods.size());
+        m_ModsByFileName[QFileInfo(mod.fileName).fileName().toLower()] = m_Mods.size();
+        m_Mods.push_back(mod);
+      } else if ((reader.name() == "fileLink") && (current != -1) && m_Mods[current].folder.isEmpty()) {
+        // real paths are relative to the virtual folder but older versions stored them absolute
+        NormalizedPath realPath(attributes.value("realPath").toString());
+        realPath.stripPrefix(virtualPrefix);
+        QStringRef relative = realPath.relative();
+        int separator = relative.indexOf('/');
+        if (separator > 0) {
+          m_Mods[current].folder = relative.left(separator).toString();
+        }
+      }
+    } else if (reader.isEndElement() && (reader.name() == "modInfo")) {
+      current = -1;
+    }
+  }
+
+  if (reader.hasError()) {
+    qWarning("failed to parse VirtualModConfig.xml: %s", qPrintable(reader.errorString()));
+    return false;
+  }
+  return true;
+}
+
+const VirtualModConfig::Mod *VirtualModConfig::findByFileName(const QString &fileName) const
+{
+  auto iter = m_ModsByFileName.find(QFileInfo(fileName).fileName().toLower());
+  if (iter == m_ModsByFileName.end()) {
+    return nullptr;
+  } else {
+    return &m_Mods[*iter];
+  }
+}
+
+QString VirtualModConfig::absoluteFolder(const Mod &mod) const
+{
+  if (mod.folder.isEmpty()) {
+    return QString();
+  } else {
+    return m_VirtualFolder + "/" + mod.folder;
+  }
+}
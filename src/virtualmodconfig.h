@@ -0,0 +1,80 @@
+/*
+Copyright (C) 2012 Sebastian Herbord. All rights reserved.
+
+This file is part of NMM Import plugin for MO
+
+NMM Import plugin is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+NMM Import plugin is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with NMM Import plugin.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef VIRTUALMODCONFIG_H
+#define VIRTUALMODCONFIG_H
+
+#include <QHash>
+#include <QString>
+#include <vector>
+
+
+/**
+ * @brief reader for the VirtualModConfig.xml of NMM 0.5 and later
+ *
+ * Starting with 0.5 NMM keeps every mod in its own folder below "VirtualModActivator"
+ * and links the files into the data directory. This reads which folder belongs to
+ * which mod archive so mods can be imported folder by folder.
+ */
+class VirtualModConfig
+{
+public:
+
+  struct Mod {
+    QString name;
+    QString fileName;
+    QString folder;
+    int nexusID;
+  };
+
+public:
+
+  /**
+   * @param virtualFolder path of the "VirtualModActivator" folder
+   */
+  explicit VirtualModConfig(const QString &virtualFolder);
+
+  /**
+   * @brief read VirtualModConfig.xml from the virtual folder
+   * @return false if the file doesn't exist or couldn't be parsed
+   */
+  bool read();
+
+  /**
+   * @brief find the mod installed from the specified archive
+   * @param fileName file name of the archive, with or without directory. Case insensitive
+   * @return the mod or nullptr if the archive isn't known
+   */
+  const Mod *findByFileName(const QString &fileName) const;
+
+  /**
+   * @return absolute path of the folder holding the files of the mod or an empty string
+   *         if the mod has no files linked
+   */
+  QString absoluteFolder(const Mod &mod) const;
+
+private:
+
+  QString m_VirtualFolder;
+  std::vector<Mod> m_Mods;
+  QHash<QString, size_t> m_ModsByFileName;
+
+};
+
+#endif // VIRTUALMODCONFIG_H
@@ -0,0 +1,270 @@
+/*
+Copyright (C) 2012 Sebastian Herbord. All rights reserved.
+
+This file is part of NMM Import plugin for MO
+
+NMM Import plugin is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+NMM Import plugin is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with NMM Import plugin.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "zipdirectory.h"
+#include "inflate.h"
+
+#include <QByteArray>
+#include <QFile>
+#include <QTextCodec>
+#include <QtEndian>
+#include <algorithm>
+#include <limits>
+
+
+namespace {
+
+const quint32 SIG_END_OF_DIRECTORY = 0x06054b50;
+const quint32 SIG_ZIP64_END_OF_DIRECTORY = 0x06064b50;
+const quint32 SIG_ZIP64_LOCATOR = 0x07064b50;
+const quint32 SIG_DIRECTORY_ENTRY = 0x02014b50;
+const quint32 SIG_LOCAL_HEADER = 0x04034b50;
+
+const int END_OF_DIRECTORY_SIZE = 22;
+const int ZIP64_LOCATOR_SIZE = 20;
+const int ZIP64_END_OF_DIRECTORY_SIZE = 56;
+const int DIRECTORY_ENTRY_SIZE = 46;
+const int LOCAL_HEADER_SIZE = 30;
+const int MAX_COMMENT_SIZE = 0xFFFF;
+
+// general purpose flags
+const quint16 FLAG_ENCRYPTED = 0x0001;
+const quint16 FLAG_UTF8 = 0x0800;
+
+const quint16 METHOD_STORE = 0;
+const quint16 METHOD_DEFLATE = 8;
+
+
+inline quint16 read16(const char *pos)
+{
+  return qFromLittleEndian<quint16>(reinterpret_cast<const uchar*>(pos));
+}
+
+inline quint32 read32(const char *pos)
+{
+  return qFromLittleEndian<quint32>(reinterpret_cast<const uchar*>(pos));
+}
+
+inline quint64 read64(const char *pos)
+{
+  return qFromLittleEndian<quint64>(reinterpret_cast<const uchar*>(pos));
+}
+
+
+/**
+ * @brief replace 32 bit fields that overflowed with the values from the zip64 extra field
+ */
+bool applyZip64Extra(const char *extra, int extraSize, ZipDirectory::Entry &entry)
+{
+  const char *end = extra + extraSize;
+  while (end - extra >= 4) {
+    quint16 id = read16(extra);
+    quint16 size = read16(extra + 2);
+    const char *data = extra + 4;
+    if (end - data < size) {
+      return false;
+    }
+    if (id == 0x0001) {
+      const char *fieldEnd = data + size;
+      // only the overflowed fields are present, in this order
+      quint64 *fields[] = { &entry.size, &entry.compressedSize, &entry.offset };
+      for (quint64 *field : fields) {
+        if (*field == 0xFFFFFFFF) {
+          if (fieldEnd - data < 8) {
+            return false;
+          }
+          *field = read64(data);
+          data += 8;
+        }
+      }
+      return true;
+    }
+    extra = data + size;
+  }
+  return true;
+}
+
+} // namespace
+
+
+bool ZipDirectory::read(const QString &fileName)
+{
+  m_FileName = fileName;
+  m_Entries.clear();
+  m_Index.clear();
+
+  QFile file(fileName);
+  if (!file.open(QIODevice::ReadOnly)) {
+    return false;
+  }
+  qint64 fileSize = file.size();
+  if (fileSize < END_OF_DIRECTORY_SIZE) {
+    return false;
+  }
+
+  // the end of directory record is followed only by the archive comment
+  qint64 tailSize = std::min<qint64>(fileSize, END_OF_DIRECTORY_SIZE + ZIP64_LOCATOR_SIZE + MAX_COMMENT_SIZE);
+  if (!file.seek(fileSize - tailSize)) {
+    return false;
+  }
+  QByteArray tail = file.read(tailSize);
+  if (tail.size() != tailSize) {
+    return false;
+  }
+
+  int endPos = -1;
+  for (int pos = tail.size() - END_OF_DIRECTORY_SIZE; pos >= 0; --pos) {
+    if ((read32(tail.constData() + pos) == SIG_END_OF_DIRECTORY)
+        && (pos + END_OF_DIRECTORY_SIZE + read16(tail.constData() + pos + 20) == tail.size())) {
+      endPos = pos;
+      break;
+    }
+  }
+  if (endPos == -1) {
+    return false;
+  }
+
+  const char *end = tail.constData() + endPos;
+  if ((read16(end + 4) != 0) || (read16(end + 6) != 0)) {
+    // spanned archive
+    return false;
+  }
+  quint64 entryCount = read16(end + 10);
+  quint64 directorySize = read32(end + 12);
+  quint64 directoryOffset = read32(end + 16);
+
+  if ((entryCount == 0xFFFF) || (directorySize == 0xFFFFFFFF) || (directoryOffset == 0xFFFFFFFF)) {
+    if (endPos < ZIP64_LOCATOR_SIZE) {
+      return false;
+    }
+    const char *locator = end - ZIP64_LOCATOR_SIZE;
+    if (read32(locator) != SIG_ZIP64_LOCATOR) {
+      return false;
+    }
+    char zip64End[ZIP64_END_OF_DIRECTORY_SIZE];
+    if (!file.seek(static_cast<qint64>(read64(locator + 8)))
+        || (file.read(zip64End, ZIP64_END_OF_DIRECTORY_SIZE) != ZIP64_END_OF_DIRECTORY_SIZE)
+        || (read32(zip64End) != SIG_ZIP64_END_OF_DIRECTORY)) {
+      return false;
+    }
+    entryCount = read64(zip64End + 32);
+    directorySize = read64(zip64End + 40);
+    directoryOffset = read64(zip64End + 48);
+  }
+
+  if ((directoryOffset + directorySize > static_cast<quint64>(fileSize))
+      || (directorySize > static_cast<quint64>(std::numeric_limits<int>::max()))
+      || (entryCount > directorySize / DIRECTORY_ENTRY_SIZE)) {
+    return false;
+  }
+  if (!file.seek(static_cast<qint64>(directoryOffset))) {
+    return false;
+  }
+  QByteArray directory = file.read(static_cast<qint64>(directorySize));
+  if (static_cast<quint64>(directory.size()) != directorySize) {
+    return false;
+  }
+
+  QTextCodec *cp437 = QTextCodec::codecForName("IBM 437");
+
+  m_Entries.reserve(static_cast<size_t>(entryCount));
+  m_Index.reserve(static_cast<int>(entryCount));
+  const char *pos = directory.constData();
+  const char *directoryEnd = pos + directory.size();
+  for (quint64 i = 0; i < entryCount; ++i) {
+    if ((directoryEnd - pos < DIRECTORY_ENTRY_SIZE) || (read32(pos) != SIG_DIRECTORY_ENTRY)) {
+      return false;
+    }
+    int nameSize = read16(pos + 28);
+    int extraSize = read16(pos + 30);
+    int commentSize = read16(pos + 32);
+    const char *name = pos + DIRECTORY_ENTRY_SIZE;
+    const char *next = name + nameSize + extraSize + commentSize;
+    if (next > directoryEnd) {
+      return false;
+    }
+
+    Entry entry;
+    entry.flags = read16(pos + 8);
+    entry.method = read16(pos + 10);
+    entry.crc = read32(pos + 16);
+    entry.compressedSize = read32(pos + 20);
+    entry.size = read32(pos + 24);
+    entry.offset = read32(pos + 42);
+    if (!applyZip64Extra(name + nameSize, extraSize, entry)) {
+      return false;
+    }
+
+    QString entryName = ((entry.flags & FLAG_UTF8) != 0) || (cp437 == nullptr)
+                          ? QString::fromUtf8(name, nameSize)
+                          : cp437->toUnicode(name, nameSize);
+    entry.name = NormalizedPath(entryName);
+    if (!m_Index.contains(entry.name)) {
+      m_Index.insert(entry.name, static_cast<int>(m_Entries.size()));
+    }
+    m_Entries.push_back(entry);
+
+    pos = next;
+  }
+
+  return true;
+}
+
+
+const ZipDirectory::Entry *ZipDirectory::find(const NormalizedPath &name) const
+{
+  auto iter = m_Index.find(name);
+  return iter != m_Index.end() ? &m_Entries[*iter] : nullptr;
+}
+
+
+bool ZipDirectory::extract(const Entry &entry, QByteArray &data) const
+{
+  if (((entry.flags & FLAG_ENCRYPTED) != 0)
+      || ((entry.method != METHOD_STORE) && (entry.method != METHOD_DEFLATE))
+      || (entry.size > static_cast<quint64>(std::numeric_limits<int>::max()))
+      || (entry.compressedSize > static_cast<quint64>(std::numeric_limits<int>::max()))) {
+    return false;
+  }
+
+  QFile file(m_FileName);
+  char header[LOCAL_HEADER_SIZE];
+  if (!file.open(QIODevice::ReadOnly)
+      || !file.seek(static_cast<qint64>(entry.offset))
+      || (file.read(header, LOCAL_HEADER_SIZE) != LOCAL_HEADER_SIZE)
+      || (read32(header) != SIG_LOCAL_HEADER)) {
+    return false;
+  }
+  // name and extra field may differ from the central directory, only their size matters
+  qint64 dataOffset = static_cast<qint64>(entry.offset) + LOCAL_HEADER_SIZE + read16(header + 26) + read16(header + 28);
+  if (!file.seek(dataOffset)) {
+    return false;
+  }
+  QByteArray compressed = file.read(static_cast<qint64>(entry.compressedSize));
+  if (static_cast<quint64>(compressed.size()) != entry.compressedSize) {
+    return false;
+  }
+
+  if (entry.method == METHOD_STORE) {
+    data = compressed;
+  } else if (!inflateRaw(compressed.constData(), compressed.size(), static_cast<size_t>(entry.size), data)) {
+    return false;
+  }
+  return crc32(data) == entry.crc;
+}
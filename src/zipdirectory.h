@@ -0,0 +1,88 @@
+/*
+Copyright (C) 2012 Sebastian Herbord. All rights reserved.
+
+This file is part of NMM Import plugin for MO
+
+NMM Import plugin is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+NMM Import plugin is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with NMM Import plugin.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef ZIPDIRECTORY_H
+#define ZIPDIRECTORY_H
+
+#include "normalizedpath.h"
+
+#include <QByteArray>
+#include <QHash>
+#include <QString>
+#include <vector>
+
+
+/**
+ * @brief the central directory of a zip file
+ *
+ * Only the directory at the end of the file is read, entries are read on request.
+ * Zip64 archives are supported, multi-volume archives are not.
+ */
+class ZipDirectory
+{
+public:
+
+  struct Entry {
+    NormalizedPath name;
+    quint64 compressedSize;
+    quint64 size;
+    // offset of the local file header
+    quint64 offset;
+    quint32 crc;
+    quint16 method;
+    quint16 flags;
+  };
+
+public:
+
+  /**
+   * @brief read the central directory of a zip file
+   * @return false if the file isn't a zip file or the directory is damaged
+   */
+  bool read(const QString &fileName);
+
+  const QString &fileName() const { return m_FileName; }
+
+  const std::vector<Entry> &entries() const { return m_Entries; }
+
+  /**
+   * @brief find an entry by name, case insensitive
+   * @return the entry or nullptr if the archive doesn't contain the file
+   */
+  const Entry *find(const NormalizedPath &name) const;
+
+  /**
+   * @brief read the content of an entry into memory
+   * @param entry an entry of this directory
+   * @param data receives the uncompressed content
+   * @return false if the entry is encrypted, uses a compression method other than
+   *         store or deflate, or is damaged
+   */
+  bool extract(const Entry &entry, QByteArray &data) const;
+
+private:
+
+  QString m_FileName;
+  std::vector<Entry> m_Entries;
+  // index into m_Entries by name. Of several entries with the same name the first is used
+  QHash<NormalizedPath, int> m_Index;
+
+};
+
+#endif // ZIPDIRECTORY_H